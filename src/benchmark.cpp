@@ -5,8 +5,24 @@
 #include <random>
 #include <chrono>
 #include <cassert>
+#include <string>
+#include <cstdlib>
+#include <memory_resource>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+#include <unistd.h>
 
 #include "os_tree.hpp"
+#include "wal.hpp"
+#include "rect_counter.hpp"
+#include "interval_tree.hpp"
+#include "compact_tree.hpp"
+#include "quantile_sketch.hpp"
+#include "buffered_tree.hpp"
+#include "concurrent_tree.hpp"
 
 template <typename T>
 int count_in_range_set(const std::set<T>& s, T fst, T snd) {
@@ -16,7 +32,7 @@ int count_in_range_set(const std::set<T>& s, T fst, T snd) {
     return (dist > 0) ? dist : 0;
 }
 
-int main() {
+void bench_range_queries() {
     const int N = 10000;
     const int M = 100000;
     const int NUM_RUNS = 5;
@@ -69,6 +85,502 @@ int main() {
 
         std::cout << "Run " << (run + 1) << ": Total found " << total_count_tree << " items in " << duration.count() << " microseconds.\n";
     }
+}
+
+// пропускная способность вставок с WAL при разных размерах group commit и время восстановления
+void bench_wal() {
+    const int N = 200000;
+    const int N_FSYNC_EACH = 2000;      // fsync на каждую вставку слишком медленный, чтобы гонять его на всем N
+
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<> dis(0, 1 << 30);
+    std::vector<int> keys(N);
+    for (int& key : keys) key = dis(gen);
+
+    char dir_template[] = "/tmp/os_tree_wal_XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::cout << "Could not create temporary directory, skipping WAL benchmark.\n";
+        return;
+    }
+    std::string base_dir = dir_template;
+
+    std::cout << "\n--- WAL insert throughput ---\n";
+    {
+        OS_Tree::SearchTree tree;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int key : keys) tree.insert(key);
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << "no durability:           " << static_cast<long long>(N / seconds) << " inserts/s\n";
+    }
+
+    const size_t group_sizes[] = {1, 16, 256, 4096};
+    for (size_t group_size : group_sizes) {
+        OS_Tree::WalOptions options;
+        options.group_commit_size   = group_size;
+        options.max_commit_delay    = std::chrono::milliseconds(10);
+        options.checkpoint_interval = 0;
+
+        std::string dir = base_dir + "/group_" + std::to_string(group_size);
+        int count = (group_size == 1) ? N_FSYNC_EACH : N;
+
+        OS_Tree::DurableTree durable(dir, options);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < count; ++i) durable.insert(keys[i]);
+        durable.sync();
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << "group commit " << group_size << ":\t " << static_cast<long long>(count / seconds) << " inserts/s\n";
+    }
+
+    std::cout << "\n--- WAL recovery ---\n";
+    {
+        std::string dir = base_dir + "/recovery";
+        OS_Tree::WalOptions options;
+        options.checkpoint_interval = 0;
+        {
+            OS_Tree::DurableTree durable(dir, options);
+            for (int i = 0; i < N; ++i) {
+                durable.insert(keys[i]);
+                if (i == N * 9 / 10) durable.checkpoint();     // 90% ключей в снимке, остальное в хвосте лога
+            }
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        OS_Tree::DurableTree recovered(dir, options);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+        const OS_Tree::RecoveryStats& stats = recovered.recovery_stats();
+        std::cout << "checkpoint keys: " << stats.checkpoint_keys << ", replayed records: " << stats.replayed_records
+                  << ", recovered in " << duration.count() << " microseconds.\n";
+    }
+
+    std::filesystem::remove_all(base_dir);
+}
+
+// подсчет точек в прямоугольниках: merge sort tree против полного перебора
+void bench_rectangles() {
+    const int N = 200000;
+    const int M = 500;
+    const int COORD_MAX = 1 << 20;
+
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<> dis(0, COORD_MAX);
+
+    std::vector<OS_Tree::Point> points(N);
+    for (OS_Tree::Point& p : points) {
+        p = {dis(gen), dis(gen)};
+    }
+
+    struct Rect { int x1, x2, y1, y2; };
+    std::vector<Rect> queries(M);
+    for (Rect& q : queries) {
+        q = {dis(gen), dis(gen), dis(gen), dis(gen)};
+        if (q.x1 > q.x2) std::swap(q.x1, q.x2);
+        if (q.y1 > q.y2) std::swap(q.y1, q.y2);
+    }
+
+    std::cout << "\n--- Rectangle counting, N=" << N << ", M=" << M << " ---\n";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    OS_Tree::RectangleCounter counter(points);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "RectangleCounter build: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    long long total_naive = 0;
+    for (const Rect& q : queries) {
+        for (const OS_Tree::Point& p : points) {
+            total_naive += (p.x_ >= q.x1 && p.x_ <= q.x2 && p.y_ >= q.y1 && p.y_ <= q.y2);
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << "naive filtering:  Total found " << total_naive << " points in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    long long total_counter = 0;
+    for (const Rect& q : queries) {
+        total_counter += counter.count(q.x1, q.x2, q.y1, q.y2);
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << "RectangleCounter: Total found " << total_counter << " points in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+}
+
+// интервалы: массовая загрузка против вставок и подсчет пересечений против линейного прохода
+void bench_intervals() {
+    const int N = 200000;
+    const int M = 500;
+    const int TIME_MAX = 1 << 24;
+
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<> start_dis(0, TIME_MAX);
+    std::uniform_int_distribution<> length_dis(0, TIME_MAX / 1000);
+
+    std::vector<OS_Tree::Interval> intervals(N);
+    for (OS_Tree::Interval& interval : intervals) {
+        interval.lo_ = start_dis(gen);
+        interval.hi_ = interval.lo_ + length_dis(gen);
+    }
+    std::vector<std::pair<int, int>> queries(M);
+    for (auto& [a, b] : queries) {
+        a = start_dis(gen);
+        b = a + length_dis(gen);
+    }
+
+    std::cout << "\n--- Interval overlap counting, N=" << N << ", M=" << M << " ---\n";
+
+    auto start = std::chrono::high_resolution_clock::now();
+    OS_Tree::IntervalTree inserted;
+    for (const OS_Tree::Interval& interval : intervals) inserted.insert(interval);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "IntervalTree inserts: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    OS_Tree::IntervalTree tree;
+    tree.assign(intervals);
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << "IntervalTree assign:  " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    long long total_naive = 0;
+    for (const auto& [a, b] : queries) {
+        for (const OS_Tree::Interval& interval : intervals) {
+            total_naive += (interval.lo_ <= b && interval.hi_ >= a);
+        }
+    }
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << "linear scan:             Total found " << total_naive << " intervals in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    long long total_count = 0;
+    for (const auto& [a, b] : queries) total_count += tree.overlap_count(a, b);
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << "IntervalTree count:      Total found " << total_count << " intervals in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+
+    start = std::chrono::high_resolution_clock::now();
+    long long total_found = 0;
+    for (const auto& [a, b] : queries) total_found += tree.find_overlapping(a, b).size();
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << "IntervalTree enumerate:  Total found " << total_found << " intervals in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+}
+
+// ресурс, который считает, сколько байт сейчас выделено через него
+class CountingResource : public std::pmr::memory_resource {
+private:
+    std::pmr::memory_resource* upstream_;
+    size_t bytes_in_use_ = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        bytes_in_use_ += bytes;
+        return upstream_->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+        bytes_in_use_ -= bytes;
+        upstream_->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : upstream_(upstream) {}
+    size_t bytes_in_use() const { return bytes_in_use_; }
+};
+
+// память на множество маленьких деревьев: обычные деревья против компактных на общем пуле
+void bench_tiny_trees() {
+    const int T = 200000;
+    const int MAX_KEYS = 31;
+
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<> count_dis(1, MAX_KEYS);
+    std::uniform_int_distribution<> key_dis(0, 1 << 30);
+    std::vector<std::vector<int>> tenants(T);
+    long long total_keys = 0;
+    for (std::vector<int>& keys : tenants) {
+        keys.resize(count_dis(gen));
+        for (int& key : keys) key = key_dis(gen);
+        total_keys += keys.size();
+    }
+
+    std::cout << "\n--- Memory for " << T << " tiny trees, " << total_keys << " keys ---\n";
+    auto report = [total_keys](const char* name, size_t bytes, long long microseconds) {
+        std::cout << name << (bytes >> 20) << " MiB, " << bytes / total_keys << " bytes/key, built in "
+                  << microseconds << " microseconds.\n";
+    };
+
+    // База - SearchTree в прежней раскладке: std::vector<Node> + sentinel_index_ + size_, без указателя на
+    // memory_resource и поколения. Узлы он выделял так же, как нынешний на ресурсе по умолчанию
+    const size_t BASELINE_TREE_SIZE = sizeof(std::vector<int>) + 2 * sizeof(int);
+    {
+        // обычные деревья берут память через ресурс по умолчанию, его и подменяем на счетчик
+        CountingResource counting;
+        std::pmr::memory_resource* previous = std::pmr::set_default_resource(&counting);
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<OS_Tree::SearchTree> trees(T);
+        for (int t = 0; t < T; ++t) {
+            for (int key : tenants[t]) trees[t].insert(key);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        report("SearchTree (baseline):   ", counting.bytes_in_use() + BASELINE_TREE_SIZE * T,
+               std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        trees.clear();
+        std::pmr::set_default_resource(previous);
+    }
+    {
+        CountingResource counting;
+        OS_Tree::NodePool pool(&counting);
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<OS_Tree::CompactSearchTree> trees;
+        trees.reserve(T);
+        for (int t = 0; t < T; ++t) {
+            trees.emplace_back(&pool);
+            for (int key : tenants[t]) trees[t].insert(key);
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        report("CompactSearchTree+pool:  ", counting.bytes_in_use() + sizeof(OS_Tree::CompactSearchTree) * T,
+               std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    }
+    std::cout << "sizeof: SearchTree " << sizeof(OS_Tree::SearchTree) << " (baseline " << BASELINE_TREE_SIZE
+              << "), CompactSearchTree " << sizeof(OS_Tree::CompactSearchTree) << " bytes.\n";
+}
+
+// точность и память QuantileSketch относительно точного SearchTree
+void bench_sketch() {
+    const int N = 1000000;
+    const int M = 1000;
+
+    std::vector<int> keys(N);
+    for (int i = 0; i < N; ++i) keys[i] = i * 3;
+    std::mt19937 gen(12345);
+    std::shuffle(keys.begin(), keys.end(), gen);
+
+    std::uniform_int_distribution<> dis(0, 3 * N);
+    std::vector<std::pair<int, int>> range_queries(M);
+    for (auto& [a, b] : range_queries) {
+        a = dis(gen);
+        b = dis(gen);
+        if (a > b) std::swap(a, b);
+    }
+
+    std::cout << "\n--- QuantileSketch vs SearchTree, N=" << N << ", M=" << M << " ---\n";
+
+    // память дерева меряем по фактическим выделениям, вместе с запасом емкости nodes_
+    CountingResource counting;
+    OS_Tree::SearchTree tree(&counting);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int key : keys) tree.insert(key);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "SearchTree: built in " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+              << " microseconds, " << ((counting.bytes_in_use() + sizeof(tree)) >> 20) << " MiB allocated.\n";
+
+    for (double epsilon : {0.01, 0.001}) {
+        OS_Tree::QuantileSketch sketch(OS_Tree::QuantileSketch::k_for_error(epsilon));
+        start = std::chrono::high_resolution_clock::now();
+        for (int key : keys) sketch.insert(key);
+        end = std::chrono::high_resolution_clock::now();
+
+        long long max_error = 0;
+        double sum_error = 0;
+        for (const auto& [a, b] : range_queries) {
+            long long error = std::llabs(sketch.count_in_range(a, b) - tree.count_in_range(a, b));
+            max_error = std::max(max_error, error);
+            sum_error += error;
+        }
+
+        std::cout << "sketch epsilon=" << epsilon << " (k=" << sketch.k() << "): built in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds, "
+                  << sketch.retained() * sizeof(int) / 1024 << " KiB retained, count_in_range error: max "
+                  << static_cast<double>(max_error) / N * 100 << "% of N, mean "
+                  << sum_error / M / N * 100 << "% of N.\n";
+    }
+}
+
+// всплеск вставок: SearchTree против BufferedSearchTree и голого push_back
+void bench_buffered() {
+    const int N = 300000;
+    const int BASE = 100000;            // сколько ключей уже было в дереве до всплеска
+
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<> dis(0, 1 << 30);
+    std::vector<int> base(BASE), burst(N);
+    for (int& key : base)  key = dis(gen);
+    for (int& key : burst) key = dis(gen);
+
+    std::cout << "\n--- Insert burst of " << N << " keys into a tree of " << BASE << " ---\n";
+    auto report = [](const char* name, std::chrono::high_resolution_clock::time_point start,
+                     std::chrono::high_resolution_clock::time_point end) {
+        double seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << name << static_cast<long long>(N / seconds) << " inserts/s\n";
+    };
+
+    {
+        std::vector<int> raw;
+        raw.reserve(N);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int key : burst) raw.push_back(key);
+        auto end = std::chrono::high_resolution_clock::now();
+        report("raw append:              ", start, end);
+    }
+    long long total_plain = 0;
+    {
+        OS_Tree::SearchTree tree;
+        for (int key : base) tree.insert(key);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int key : burst) tree.insert(key);
+        auto end = std::chrono::high_resolution_clock::now();
+        report("SearchTree:              ", start, end);
+        total_plain = tree.count_in_range(0, 1 << 29);
+    }
+    for (size_t capacity : {1024, 65536}) {
+        OS_Tree::BufferedSearchTree tree(capacity);
+        for (int key : base) tree.insert(key);
+        tree.flush();
+        auto start = std::chrono::high_resolution_clock::now();
+        for (int key : burst) tree.insert(key);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << "buffer " << capacity << (capacity < 10000 ? ":\t\t " : ":\t ");
+        report("", start, end);
+
+        start = std::chrono::high_resolution_clock::now();
+        long long total = tree.count_in_range(0, 1 << 29);
+        tree.flush();
+        end = std::chrono::high_resolution_clock::now();
+        std::cout << "  first query + flush of the rest: "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds"
+                  << (total == total_plain ? "" : " (MISMATCH)") << "\n";
+    }
+}
+
+// SearchTree под std::mutex, для сравнения с ConcurrentSearchTree
+class MutexSearchTree {
+private:
+    OS_Tree::SearchTree tree_;
+    mutable std::mutex mutex_;
+
+public:
+    void insert(int key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tree_.insert(key);
+    }
+    int count_in_range(int a, int b) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tree_.count_in_range(a, b);
+    }
+};
+
+// смешанная нагрузка: producers вставляют, consumers считают отрезки, меряем суммарную пропускную способность
+template <typename Tree>
+double run_mixed_load(int producers, int consumers, int ops_per_thread) {
+    Tree tree;
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&tree, p, ops_per_thread] {
+            std::mt19937 gen(p);
+            std::uniform_int_distribution<> dis(0, 1 << 30);
+            for (int i = 0; i < ops_per_thread; ++i) tree.insert(dis(gen));
+        });
+    }
+    for (int c = 0; c < consumers; ++c) {
+        threads.emplace_back([&tree, c, ops_per_thread] {
+            std::mt19937 gen(1000 + c);
+            std::uniform_int_distribution<> dis(0, 1 << 30);
+            long long total = 0;
+            for (int i = 0; i < ops_per_thread; ++i) {
+                int a = dis(gen), b = dis(gen);
+                total += tree.count_in_range(std::min(a, b), std::max(a, b));
+            }
+            volatile long long sink = total;
+            (void)sink;
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    return (producers + consumers) * static_cast<double>(ops_per_thread) / seconds;
+}
+
+void bench_concurrent() {
+    const int OPS_PER_THREAD = 50000;
+
+    std::cout << "\n--- Mixed producer/consumer load, " << OPS_PER_THREAD << " ops per thread, "
+              << std::thread::hardware_concurrency() << " hardware threads ---\n";
+    for (int threads : {1, 2, 4, 8}) {
+        double mutex_ops      = run_mixed_load<MutexSearchTree>(threads, threads, OPS_PER_THREAD);
+        double concurrent_ops = run_mixed_load<OS_Tree::ConcurrentSearchTree>(threads, threads, OPS_PER_THREAD);
+        std::cout << threads << " producers + " << threads << " consumers: std::mutex "
+                  << static_cast<long long>(mutex_ops) << " ops/s, ConcurrentSearchTree "
+                  << static_cast<long long>(concurrent_ops) << " ops/s\n";
+    }
+}
+
+// rank на "состаренном" случайными вставками дереве до и после перекладки и на свежепостроенном
+void bench_relayout() {
+    const int N = 500000;
+    const int M = 1000000;
+    const int SLICE = 4096;
+
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<> dis(0, 1 << 30);
+    std::vector<int> queries(M);
+    for (int& x : queries) x = dis(gen);
+
+    OS_Tree::SearchTree aged;
+    for (int i = 0; i < N; ++i) aged.insert(dis(gen));
+    OS_Tree::SearchTree fresh;
+    fresh.assign_sorted(aged.keys());
+
+    std::cout << "\n--- rank latency on an aged tree, N=" << aged.size() << ", M=" << M << " ---\n";
+    auto measure = [&queries](const char* name, const OS_Tree::SearchTree& tree) {
+        auto start = std::chrono::high_resolution_clock::now();
+        long long total = 0;
+        for (int x : queries) total += tree.rank(x);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
+        std::cout << name << duration.count() / M << " ns/rank (checksum " << total << ")\n";
+    };
+
+    measure("aged:            ", aged);
+    measure("fresh:           ", fresh);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    OS_Tree::SearchTree::RelayoutCursor cursor(aged);
+    int slices = 1;
+    while (!cursor.step(SLICE)) slices++;
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "relayout in " << slices << " slices of " << SLICE << " nodes: "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " microseconds.\n";
+
+    measure("after relayout:  ", aged);
+}
+
+// без аргументов запускаются все замеры, иначе только перечисленные
+int main(int argc, char* argv[]) {
+    auto selected = [argc, argv](const std::string& name) {
+        if (argc == 1) return true;
+        for (int i = 1; i < argc; ++i) {
+            if (name == argv[i]) return true;
+        }
+        return false;
+    };
+
+    if (selected("range")) bench_range_queries();
+    if (selected("wal"))   bench_wal();
+    if (selected("rect"))  bench_rectangles();
+    if (selected("interval")) bench_intervals();
+    if (selected("tiny"))  bench_tiny_trees();
+    if (selected("sketch")) bench_sketch();
+    if (selected("buffered")) bench_buffered();
+    if (selected("concurrent")) bench_concurrent();
+    if (selected("relayout")) bench_relayout();
 
     return 0;
 }
@@ -0,0 +1,88 @@
+#include "buffered_tree.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+
+namespace OS_Tree {
+
+namespace {
+
+// при пачке хотя бы в 1/16 дерева слияние с перестройкой дешевле m вставок по O(log n)
+const int REBUILD_RATIO = 16;
+
+}
+
+BufferedSearchTree::BufferedSearchTree(size_t buffer_capacity) : buffer_capacity_(buffer_capacity) {
+    if (buffer_capacity_ == 0) {
+        throw std::invalid_argument("BufferedSearchTree: buffer capacity must be positive");
+    }
+    buffer_.reserve(buffer_capacity_);
+}
+
+void BufferedSearchTree::insert(int key) {
+    buffer_.push_back(key);
+    buffer_prepared_ = false;
+    if (buffer_.size() >= buffer_capacity_) {
+        flush();
+    }
+}
+
+void BufferedSearchTree::prepare_buffer() const {
+    if (buffer_prepared_) return;
+
+    std::sort(buffer_.begin(), buffer_.end());
+    buffer_.erase(std::unique(buffer_.begin(), buffer_.end()), buffer_.end());
+    buffer_.erase(std::remove_if(buffer_.begin(), buffer_.end(), [this](int key) {
+        return tree_.contains(key);
+    }), buffer_.end());
+    buffer_prepared_ = true;
+}
+
+void BufferedSearchTree::flush() {
+    if (buffer_.empty()) return;
+    if (!buffer_prepared_) {
+        // проверять ключи по дереву здесь незачем: вставка и set_union сами пропускают повторы
+        std::sort(buffer_.begin(), buffer_.end());
+        buffer_.erase(std::unique(buffer_.begin(), buffer_.end()), buffer_.end());
+    }
+
+    if (buffer_.size() * REBUILD_RATIO >= static_cast<size_t>(tree_.size())) {
+        std::vector<int> old_keys = tree_.keys();
+        std::vector<int> merged;
+        merged.reserve(old_keys.size() + buffer_.size());
+        std::set_union(old_keys.begin(), old_keys.end(), buffer_.begin(), buffer_.end(), std::back_inserter(merged));
+        tree_.assign_sorted(merged);
+    } else {
+        for (int key : buffer_) {
+            tree_.insert(key);
+        }
+    }
+    buffer_.clear();
+    buffer_prepared_ = true;
+}
+
+int BufferedSearchTree::rank(int x) const {
+    prepare_buffer();
+    return tree_.rank(x) + (std::upper_bound(buffer_.begin(), buffer_.end(), x) - buffer_.begin());
+}
+
+int BufferedSearchTree::count_in_range(int a, int b) const {
+    if (a > b) { return 0; }
+    return rank(b) - rank(a - 1);
+}
+
+int BufferedSearchTree::size() const {
+    prepare_buffer();
+    return tree_.size() + buffer_.size();
+}
+
+size_t BufferedSearchTree::buffered() const {
+    return buffer_.size();
+}
+
+const SearchTree& BufferedSearchTree::tree() const {
+    return tree_;
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "os_tree.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace OS_Tree {
+
+// SearchTree для всплесков вставок: insert только дописывает ключ в буфер, а в дерево буфер
+// вливается пачкой, когда заполнится или по flush(). Пачка либо вставляется в дерево в порядке
+// возрастания (соседние вставки проходят по одному пути и попадают в кэш), либо, если она сравнима
+// по размеру с деревом, дерево целиком перестраивается слиянием за O(n + m) через assign_sorted.
+// rank и count_in_range точные: перед запросом буфер сортируется, из него убираются повторы
+// и ключи, которые уже есть в дереве, и он досчитывается бинарным поиском.
+class BufferedSearchTree {
+private:
+    SearchTree tree_;
+    size_t buffer_capacity_;
+
+    // запросы const, но приводят буфер в порядок, поэтому он mutable;
+    // как и у SearchTree, одновременные запросы из разных потоков не поддерживаются
+    mutable std::vector<int> buffer_;
+    mutable bool buffer_prepared_ = true;       // buffer_ отсортирован, без повторов и без ключей tree_
+
+    void prepare_buffer() const;
+
+public:
+    explicit BufferedSearchTree(size_t buffer_capacity = 4096);
+
+    void insert(int key);
+    // вливает буфер в дерево
+    void flush();
+
+    int rank(int x) const;
+    int count_in_range(int a, int b) const;
+    int size() const;
+
+    size_t buffered() const;
+    // дерево без учета буфера, для полного состояния сначала нужен flush()
+    const SearchTree& tree() const;
+};
+
+}
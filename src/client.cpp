@@ -0,0 +1,77 @@
+// Небольшой клиент для tree_app --server: отправляет stdin в сокет целиком (конвейером),
+// затем закрывает свою сторону на запись и печатает все ответы сервера.
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <socket_path>" << std::endl;
+        return 1;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, argv[1], sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+        std::cerr << "tree_client: could not connect to " << argv[1] << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    // пишем и читаем одновременно, иначе на большом входе оба конца упрутся в заполненные буферы сокета
+    char in_buffer[64 * 1024];
+    char out_buffer[64 * 1024];
+    size_t pending = 0, offset = 0;
+    bool stdin_done = false;
+
+    while (true) {
+        // stdin опрашиваем, только когда его данные уже отправлены: иначе poll вернет POLLHUP
+        // от закрытого пайпа, и мы затрем неотправленный буфер или закроем сокет раньше времени
+        bool want_stdin = !stdin_done && pending == offset;
+        pollfd fds[2] = {
+            {fd, POLLIN, 0},
+            {want_stdin ? STDIN_FILENO : -1, POLLIN, 0}
+        };
+        if (!stdin_done && pending != offset) {
+            fds[0].events |= POLLOUT;
+        }
+        if (poll(fds, 2, -1) == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (want_stdin && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+            ssize_t got = read(STDIN_FILENO, in_buffer, sizeof(in_buffer));
+            if (got <= 0) {
+                stdin_done = true;
+                shutdown(fd, SHUT_WR);
+            } else {
+                pending = got;
+                offset  = 0;
+            }
+        }
+        if (fds[0].revents & POLLOUT) {
+            ssize_t sent = send(fd, in_buffer + offset, pending - offset, MSG_NOSIGNAL);
+            if (sent == -1) break;
+            offset += sent;
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP)) {
+            ssize_t got = read(fd, out_buffer, sizeof(out_buffer));
+            if (got <= 0) break;                    // сервер ответил на все и закрыл соединение
+            std::cout.write(out_buffer, got);
+        }
+    }
+
+    std::cout.flush();
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include "compact_tree.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+namespace OS_Tree {
+
+#ifdef DEBUG
+#define DBG_PRINT(...) printf("%s:%d    ", __func__, __LINE__);  \
+                       printf(__VA_ARGS__)
+#else
+#define DBG_PRINT(...)
+#endif
+
+CompactSearchTree::CompactSearchTree(std::pmr::memory_resource* pool) : repr_(InlineKeys{}), pool_(pool) {}
+
+bool CompactSearchTree::is_inline_mode() const {
+    return std::holds_alternative<InlineKeys>(repr_);
+}
+
+void CompactSearchTree::insert(int key) {
+    InlineKeys* small = std::get_if<InlineKeys>(&repr_);
+    if (!small) {
+        std::get<SearchTree>(repr_).insert(key);
+        return;
+    }
+
+    int* begin = small->keys_.data();
+    int* end   = begin + small->size_;
+    int* pos   = std::lower_bound(begin, end, key);
+    if (pos != end && *pos == key) return;                          // такой ключ уже есть
+
+    if (small->size_ == INLINE_CAPACITY) {
+        promote(key);
+        return;
+    }
+    std::copy_backward(pos, end, end + 1);
+    *pos = key;
+    small->size_++;
+}
+
+void CompactSearchTree::promote(int key) {
+    const InlineKeys& small = std::get<InlineKeys>(repr_);
+    DBG_PRINT("promoting %d inline keys\n", small.size_);
+    std::vector<int> keys(small.keys_.begin(), small.keys_.begin() + small.size_);
+    keys.insert(std::lower_bound(keys.begin(), keys.end(), key), key);
+
+    repr_.emplace<SearchTree>(pool_).assign_sorted(keys);
+}
+
+void CompactSearchTree::assign_sorted(const std::vector<int>& keys) {
+    if (keys.size() > INLINE_CAPACITY) {
+        SearchTree* tree = std::get_if<SearchTree>(&repr_);
+        if (!tree) {
+            tree = &repr_.emplace<SearchTree>(pool_);
+        }
+        tree->assign_sorted(keys);
+        return;
+    }
+
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (keys[i - 1] >= keys[i]) {
+            throw std::invalid_argument("assign_sorted: keys must be strictly increasing");
+        }
+    }
+    InlineKeys small{};                                             // узлы SearchTree, если были, вернутся в пул
+    std::copy(keys.begin(), keys.end(), small.keys_.begin());
+    small.size_ = keys.size();
+    repr_ = small;
+}
+
+bool CompactSearchTree::contains(int key) const {
+    if (const InlineKeys* small = std::get_if<InlineKeys>(&repr_)) {
+        return std::binary_search(small->keys_.begin(), small->keys_.begin() + small->size_, key);
+    }
+    return std::get<SearchTree>(repr_).contains(key);
+}
+
+int CompactSearchTree::size() const {
+    if (const InlineKeys* small = std::get_if<InlineKeys>(&repr_)) {
+        return small->size_;
+    }
+    return std::get<SearchTree>(repr_).size();
+}
+
+std::vector<int> CompactSearchTree::keys() const {
+    if (const InlineKeys* small = std::get_if<InlineKeys>(&repr_)) {
+        return std::vector<int>(small->keys_.begin(), small->keys_.begin() + small->size_);
+    }
+    return std::get<SearchTree>(repr_).keys();
+}
+
+int CompactSearchTree::rank(int x) const {
+    if (const InlineKeys* small = std::get_if<InlineKeys>(&repr_)) {
+        // без ветвлений по всем ключам: на нескольких десятках ключей это быстрее бинарного поиска
+        // и компилятор векторизует цикл
+        int result = 0;
+        for (int i = 0; i < small->size_; ++i) {
+            result += small->keys_[i] <= x;
+        }
+        return result;
+    }
+    return std::get<SearchTree>(repr_).rank(x);
+}
+
+int CompactSearchTree::count_in_range(int a, int b) const {
+    if (a > b) { return 0; }
+    return rank(b) - rank(a - 1);
+}
+
+}
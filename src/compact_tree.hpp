@@ -0,0 +1,55 @@
+#pragma once
+
+#include "os_tree.hpp"
+
+#include <array>
+#include <variant>
+#include <vector>
+#include <memory_resource>
+
+namespace OS_Tree {
+
+// Дерево для множества маленьких деревьев (по одному на арендатора и т.п.).
+// Пока ключей не больше INLINE_CAPACITY, они лежат отсортированными прямо в объекте: ни узлов,
+// ни sentinel, ни выделений в куче. При переполнении дерево один раз перестраивается в обычный
+// SearchTree, который берет память под узлы из pool (например, общего NodePool на много деревьев).
+// Место под массив есть только у CompactSearchTree, обычный SearchTree за него не платит.
+// pool должен пережить дерево; копия дерева после перехода в AVL берет память из ресурса по умолчанию
+class CompactSearchTree {
+public:
+    // сколько ключей дерево хранит отсортированным массивом внутри объекта
+    static constexpr int INLINE_CAPACITY = 32;
+
+private:
+    // без инициализаторов полей: иначе variant не считает тип конструируемым по умолчанию внутри класса,
+    // пустой массив создается как InlineKeys{}
+    struct InlineKeys {
+        std::array<int, INLINE_CAPACITY> keys_;
+        int size_;
+    };
+
+    std::variant<InlineKeys, SearchTree> repr_;
+    std::pmr::memory_resource* pool_;
+
+    // переносит ключи массива и key в SearchTree
+    void promote(int key);
+
+public:
+    explicit CompactSearchTree(std::pmr::memory_resource* pool = std::pmr::get_default_resource());
+
+    void insert(int key);
+    // заменяет содержимое дерева ключами из keys (строго возрастающими); небольшой набор снова ложится в массив
+    void assign_sorted(const std::vector<int>& keys);
+
+    bool contains(int key) const;
+    int size() const;
+    // true, пока ключи хранятся массивом внутри объекта
+    bool is_inline_mode() const;
+    // все ключи в порядке возрастания
+    std::vector<int> keys() const;
+
+    int rank(int x) const;
+    int count_in_range(int a, int b) const;
+};
+
+}
@@ -0,0 +1,108 @@
+#include "concurrent_tree.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+namespace OS_Tree {
+
+ConcurrentSearchTree::ConcurrentSearchTree() {
+    // в пачке не больше MAX_SLOTS вставок, так что комбайнер никогда не выделяет память
+    batch_.reserve(MAX_SLOTS);
+    batch_slots_.reserve(MAX_SLOTS);
+}
+
+int ConcurrentSearchTree::claim_slot() {
+    // начинаем с "своего" слота, чтобы потоки реже сталкивались на одних и тех же
+    int start = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_SLOTS;
+    while (true) {
+        for (int i = 0; i < MAX_SLOTS; ++i) {
+            int slot = (start + i) % MAX_SLOTS;
+            int expected = EMPTY;
+            if (slots_[slot].state_.load(std::memory_order_relaxed) == EMPTY &&
+                slots_[slot].state_.compare_exchange_strong(expected, CLAIMED, std::memory_order_acquire)) {
+                return slot;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void ConcurrentSearchTree::insert(int key) {
+    Slot& slot = slots_[claim_slot()];
+    slot.key_ = key;
+    slot.state_.store(PENDING, std::memory_order_release);
+
+    while (true) {
+        int state = slot.state_.load(std::memory_order_acquire);
+        if (state == DONE) {
+            slot.state_.store(EMPTY, std::memory_order_release);
+            return;
+        }
+        if (state == FAILED) {
+            std::exception_ptr error = std::move(slot.error_);
+            slot.error_ = nullptr;
+            slot.state_.store(EMPTY, std::memory_order_release);
+            std::rethrow_exception(error);
+        }
+        // пока комбайнер работает, флаг только читаем, чтобы не отнимать у него кэш-линию
+        if (!combining_.load(std::memory_order_relaxed) &&
+            !combining_.exchange(true, std::memory_order_acquire)) {
+            // наш слот уже PENDING, поэтому комбайнер гарантированно его применит
+            combine();
+            combining_.store(false, std::memory_order_release);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void ConcurrentSearchTree::combine() noexcept {
+    batch_.clear();
+    batch_slots_.clear();
+    for (int i = 0; i < MAX_SLOTS; ++i) {
+        if (slots_[i].state_.load(std::memory_order_acquire) == PENDING) {
+            batch_.push_back(slots_[i].key_);
+            batch_slots_.push_back(i);
+        }
+    }
+    if (batch_.empty()) return;
+
+    // по возрастанию соседние вставки проходят по одному пути в дереве
+    std::sort(batch_.begin(), batch_.end());
+    try {
+        std::unique_lock<std::shared_mutex> lock(tree_mutex_);
+        for (int key : batch_) {
+            tree_.insert(key);
+        }
+    } catch (...) {
+        // оставить слоты PENDING нельзя: их писатели ждали бы вечно
+        std::exception_ptr error = std::current_exception();
+        for (int slot : batch_slots_) {
+            slots_[slot].error_ = error;
+            slots_[slot].state_.store(FAILED, std::memory_order_release);
+        }
+        return;
+    }
+
+    for (int slot : batch_slots_) {
+        slots_[slot].state_.store(DONE, std::memory_order_release);
+    }
+}
+
+int ConcurrentSearchTree::rank(int x) const {
+    std::shared_lock<std::shared_mutex> lock(tree_mutex_);
+    return tree_.rank(x);
+}
+
+int ConcurrentSearchTree::count_in_range(int a, int b) const {
+    std::shared_lock<std::shared_mutex> lock(tree_mutex_);
+    return tree_.count_in_range(a, b);
+}
+
+int ConcurrentSearchTree::size() const {
+    std::shared_lock<std::shared_mutex> lock(tree_mutex_);
+    return tree_.size();
+}
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "os_tree.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+#include <exception>
+
+namespace OS_Tree {
+
+// Потокобезопасная обертка над SearchTree для нескольких писателей и читателей.
+//
+// Писатели не берут блокировку дерева по очереди, а используют flat combining: вставка публикуется
+// в свободный слот общего списка, после чего один из писателей становится комбайнером (флаг combining_),
+// собирает все опубликованные вставки, сортирует их и применяет одной пачкой под одним захватом
+// эксклюзивной блокировки. Остальные писатели в это время крутятся на своем слоте, пока он не будет
+// помечен выполненным: флаг комбайнера они только читают (test-and-test-and-set) и пытаются захватить
+// его, лишь когда комбайнера нет, поэтому его кэш-линия не мечется между ядрами.
+//
+// Читатели (rank, count_in_range, size) работают параллельно под std::shared_mutex, который
+// в glibc отдает предпочтение читателям. count_in_range считается под одним захватом и
+// поэтому согласован с пачками вставок.
+class ConcurrentSearchTree {
+public:
+    // сколько вставок может быть опубликовано одновременно; больше потоков ждут свободного слота
+    static constexpr int MAX_SLOTS = 64;
+
+private:
+    enum SlotState : int {
+        EMPTY,          // слот свободен
+        CLAIMED,        // писатель занял слот и записывает ключ
+        PENDING,        // ключ опубликован и ждет комбайнера
+        DONE,           // комбайнер применил вставку, писатель может освобождать слот
+        FAILED          // вставка пачки бросила исключение, оно лежит в error_ слота
+    };
+
+    // каждый слот на своей кэш-линии, чтобы публикации разных потоков не мешали друг другу
+    struct alignas(64) Slot {
+        std::atomic<int> state_{EMPTY};
+        int key_ = 0;
+        std::exception_ptr error_;
+    };
+
+    SearchTree tree_;
+    mutable std::shared_mutex tree_mutex_;
+
+    alignas(64) std::atomic<bool> combining_{false};    // есть активный комбайнер
+    Slot slots_[MAX_SLOTS];
+    std::vector<int> batch_;            // используется только комбайнером
+    std::vector<int> batch_slots_;
+
+    int claim_slot();
+    // вызывается только комбайнером; ошибка пачки достается всем ее писателям, сам не бросает
+    void combine() noexcept;
+
+public:
+    ConcurrentSearchTree();
+    ConcurrentSearchTree(const ConcurrentSearchTree&) = delete;
+    ConcurrentSearchTree& operator=(const ConcurrentSearchTree&) = delete;
+
+    // возвращается, когда ключ уже виден читателям. Если вставка пачки бросила исключение,
+    // его получают все писатели этой пачки; ключи такой пачки могут оказаться вставлены лишь частично
+    void insert(int key);
+
+    int rank(int x) const;
+    int count_in_range(int a, int b) const;
+    int size() const;
+};
+
+}
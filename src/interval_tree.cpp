@@ -0,0 +1,220 @@
+#include "interval_tree.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+
+namespace OS_Tree {
+
+// accessors ====================================================================================================================//
+
+int IntervalTree::height(const Layer& layer, int node_index) {
+    return node_index == -1 ? 0 : layer.nodes_[node_index].height_;
+}
+
+int IntervalTree::subtree_size(const Layer& layer, int node_index) {
+    return node_index == -1 ? 0 : layer.nodes_[node_index].subtree_size_;
+}
+
+int IntervalTree::get_balance(const Layer& layer, int node_index) {
+    if (node_index == -1) return 0;
+    const Node& node = layer.nodes_[node_index];
+    return height(layer, node.left_index_) - height(layer, node.right_index_);
+}
+
+int IntervalTree::size() const {
+    return subtree_size(intervals_, intervals_.root_index_);
+}
+
+// обновление состояния и балансировка ==========================================================================================//
+
+void IntervalTree::upd_node_ctx(Layer& layer, int node_index) {
+    Node& node = layer.nodes_[node_index];
+
+    node.height_       = std::max(height(layer, node.left_index_), height(layer, node.right_index_)) + 1;
+    node.subtree_size_ = subtree_size(layer, node.left_index_) + subtree_size(layer, node.right_index_) + 1;
+
+    node.max_hi_ = node.hi_;
+    if (node.left_index_ != -1) {
+        node.max_hi_ = std::max(node.max_hi_, layer.nodes_[node.left_index_].max_hi_);
+    }
+    if (node.right_index_ != -1) {
+        node.max_hi_ = std::max(node.max_hi_, layer.nodes_[node.right_index_].max_hi_);
+    }
+}
+
+int IntervalTree::right_rotate(Layer& layer, int B) {
+    int A = layer.nodes_[B].left_index_;
+    if (A == -1) {
+        throw std::invalid_argument("right_rotate: left child of local root is inactive");
+    }
+
+    layer.nodes_[B].left_index_  = layer.nodes_[A].right_index_;     // B.left  = A.right
+    layer.nodes_[A].right_index_ = B;                                // A.right = B
+
+    // сначала нижний узел: max_hi_ A зависит от уже пересчитанного B
+    upd_node_ctx(layer, B);
+    upd_node_ctx(layer, A);
+    return A;
+}
+
+int IntervalTree::left_rotate(Layer& layer, int A) {
+    int B = layer.nodes_[A].right_index_;
+    if (B == -1) {
+        throw std::invalid_argument("left_rotate: right child of local root is inactive");
+    }
+
+    layer.nodes_[A].right_index_ = layer.nodes_[B].left_index_;      // A.right = B.left
+    layer.nodes_[B].left_index_  = A;                                // B.left  = A
+
+    upd_node_ctx(layer, A);
+    upd_node_ctx(layer, B);
+    return B;
+}
+
+int IntervalTree::balance_node(Layer& layer, int node_index) {
+    upd_node_ctx(layer, node_index);
+    int balance = get_balance(layer, node_index);
+
+    if (balance > 1) {
+        int& left_index = layer.nodes_[node_index].left_index_;
+        // Левый правый сводится к левому левому
+        if (get_balance(layer, left_index) < 0) {
+            left_index = left_rotate(layer, left_index);
+        }
+        return right_rotate(layer, node_index);
+    }
+    if (balance < -1) {
+        int& right_index = layer.nodes_[node_index].right_index_;
+        // Правый левый сводится к правому правому
+        if (get_balance(layer, right_index) > 0) {
+            right_index = right_rotate(layer, right_index);
+        }
+        return left_rotate(layer, node_index);
+    }
+    return node_index;
+}
+
+// вставка и построение =========================================================================================================//
+
+int IntervalTree::insert(Layer& layer, int node_index, int lo, int hi) {
+    if (node_index == -1) {
+        layer.nodes_.emplace_back(lo, hi);
+        return layer.nodes_.size() - 1;
+    }
+
+    const Node& node = layer.nodes_[node_index];
+    bool go_left = lo < node.lo_ || (lo == node.lo_ && hi < node.hi_);
+    // рекурсия может перевыделить nodes_, поэтому ссылку на поле берем только после нее
+    if (go_left) {
+        int new_left = insert(layer, node.left_index_, lo, hi);
+        layer.nodes_[node_index].left_index_ = new_left;
+    } else {
+        int new_right = insert(layer, node.right_index_, lo, hi);
+        layer.nodes_[node_index].right_index_ = new_right;
+    }
+
+    return balance_node(layer, node_index);
+}
+
+void IntervalTree::insert(const Interval& interval) {
+    if (interval.lo_ > interval.hi_) {
+        throw std::invalid_argument("IntervalTree::insert: interval with lo > hi");
+    }
+    intervals_.root_index_ = insert(intervals_, intervals_.root_index_, interval.lo_, interval.hi_);
+    ends_.root_index_      = insert(ends_,      ends_.root_index_,      interval.hi_, interval.hi_);
+}
+
+int IntervalTree::build_balanced(Layer& layer, const std::vector<Interval>& sorted, int lo, int hi) {
+    if (lo >= hi) return -1;
+
+    int mid = lo + (hi - lo) / 2;
+    int node_index = layer.nodes_.size();
+    layer.nodes_.emplace_back(sorted[mid].lo_, sorted[mid].hi_);
+
+    int left_index  = build_balanced(layer, sorted, lo, mid);
+    int right_index = build_balanced(layer, sorted, mid + 1, hi);
+    layer.nodes_[node_index].left_index_  = left_index;
+    layer.nodes_[node_index].right_index_ = right_index;
+    upd_node_ctx(layer, node_index);
+
+    return node_index;
+}
+
+void IntervalTree::assign(std::vector<Interval> intervals) {
+    for (const Interval& interval : intervals) {
+        if (interval.lo_ > interval.hi_) {
+            throw std::invalid_argument("IntervalTree::assign: interval with lo > hi");
+        }
+    }
+
+    std::sort(intervals.begin(), intervals.end(), [](const Interval& lhs, const Interval& rhs) {
+        return lhs.lo_ < rhs.lo_ || (lhs.lo_ == rhs.lo_ && lhs.hi_ < rhs.hi_);
+    });
+    std::vector<Interval> ends(intervals.size());
+    for (size_t i = 0; i < intervals.size(); ++i) {
+        ends[i] = {intervals[i].hi_, intervals[i].hi_};
+    }
+    std::sort(ends.begin(), ends.end(), [](const Interval& lhs, const Interval& rhs) {
+        return lhs.lo_ < rhs.lo_;
+    });
+
+    intervals_ = Layer();
+    ends_      = Layer();
+    intervals_.nodes_.reserve(intervals.size());
+    ends_.nodes_.reserve(ends.size());
+    intervals_.root_index_ = build_balanced(intervals_, intervals, 0, intervals.size());
+    ends_.root_index_      = build_balanced(ends_,      ends,      0, ends.size());
+}
+
+// запросы ======================================================================================================================//
+
+int IntervalTree::count_lo(const Layer& layer, int x, bool or_equal) {
+    int result = 0;
+    int node_index = layer.root_index_;
+    while (node_index != -1) {
+        const Node& node = layer.nodes_[node_index];
+        if (node.lo_ < x || (or_equal && node.lo_ == x)) {
+            // текущий узел и все его левое поддерево подходят
+            result += subtree_size(layer, node.left_index_) + 1;
+            node_index = node.right_index_;
+        } else {
+            node_index = node.left_index_;
+        }
+    }
+    return result;
+}
+
+int IntervalTree::stab_count(int t) const {
+    return count_lo(intervals_, t, true) - count_lo(ends_, t, false);
+}
+
+int IntervalTree::overlap_count(int a, int b) const {
+    if (a > b) { return 0; }
+    return count_lo(intervals_, b, true) - count_lo(ends_, a, false);
+}
+
+void IntervalTree::collect_overlapping(int node_index, int a, int b, std::vector<Interval>& result) const {
+    if (node_index == -1) return;
+    const Node& node = intervals_.nodes_[node_index];
+    if (node.max_hi_ < a) return;                               // все поддерево заканчивается левее a
+
+    collect_overlapping(node.left_index_, a, b, result);
+    if (node.lo_ > b) return;                                   // у правого поддерева lo_ еще больше
+    if (node.hi_ >= a) {
+        result.push_back({node.lo_, node.hi_});
+    }
+    collect_overlapping(node.right_index_, a, b, result);
+}
+
+std::vector<Interval> IntervalTree::find_overlapping(int a, int b) const {
+    std::vector<Interval> result;
+    if (a > b) { return result; }
+    collect_overlapping(intervals_.root_index_, a, b, result);
+    return result;
+}
+
+std::vector<Interval> IntervalTree::find_stabbing(int t) const {
+    return find_overlapping(t, t);
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+namespace OS_Tree {
+
+// замкнутый интервал [lo_, hi_], lo_ <= hi_
+struct Interval {
+    int lo_;
+    int hi_;
+
+    bool operator==(const Interval& other) const { return lo_ == other.lo_ && hi_ == other.hi_; }
+};
+
+// AVL-дерево интервалов в стиле SearchTree: узлы лежат в std::vector и ссылаются друг на друга индексами.
+// Узлы упорядочены по (lo_, hi_), одинаковые интервалы допускаются. Каждый узел дополнительно хранит
+// max_hi_ - максимальный правый конец в поддереве, он пересчитывается в left_rotate/right_rotate
+// вместе с высотой и размером поддерева и позволяет перечислять пересечения, отсекая целые поддеревья.
+//
+// Для подсчетов за O(log n) рядом хранится второе дерево того же вида, упорядоченное по правым концам:
+//   stab_count(t)        = #{lo <= t} - #{hi < t}
+//   overlap_count(a, b)  = #{lo <= b} - #{hi < a}
+// (интервал с hi < t целиком лежит левее t, поэтому вычитается из уже посчитанных lo <= t).
+class IntervalTree {
+private:
+
+    struct Node {
+        int lo_;
+        int hi_;
+        int max_hi_;                // максимум hi_ в поддереве, ВКЛЮЧАЯ node
+        int height_       = 1;
+        int subtree_size_ = 1;
+
+        int left_index_   = -1;
+        int right_index_  = -1;
+
+        Node(int lo, int hi) : lo_(lo), hi_(hi), max_hi_(hi) {}
+    };
+
+    // отдельное AVL-дерево: массив узлов и индекс корня
+    struct Layer {
+        std::vector<Node> nodes_;
+        int root_index_ = -1;
+    };
+
+    Layer intervals_;               // интервалы по (lo_, hi_)
+    Layer ends_;                    // только правые концы: узлы вида [hi, hi]
+
+    // accessors, для -1 возвращают значения пустого поддерева
+    static int height(const Layer& layer, int node_index);
+    static int subtree_size(const Layer& layer, int node_index);
+    static int get_balance(const Layer& layer, int node_index);
+
+    // пересчитать height_, subtree_size_ и max_hi_ по потомкам
+    static void upd_node_ctx(Layer& layer, int node_index);
+
+    static int right_rotate(Layer& layer, int B);
+    static int left_rotate(Layer& layer, int A);
+    // восстанавливает AVL-инвариант в узле, возвращает новый корень поддерева
+    static int balance_node(Layer& layer, int node_index);
+
+    // вставка в поддерево с корнем node_index, возвращает новый корень поддерева
+    static int insert(Layer& layer, int node_index, int lo, int hi);
+    // строит идеально сбалансированное поддерево из sorted[lo, hi)
+    static int build_balanced(Layer& layer, const std::vector<Interval>& sorted, int lo, int hi);
+
+    // число узлов с lo_ <= x (or_equal) или lo_ < x
+    static int count_lo(const Layer& layer, int x, bool or_equal);
+
+    void collect_overlapping(int node_index, int a, int b, std::vector<Interval>& result) const;
+
+public:
+
+    void insert(const Interval& interval);
+    // заменяет содержимое дерева за O(n log n) на сортировку и O(n) на построение
+    void assign(std::vector<Interval> intervals);
+
+    int size() const;
+
+    // число интервалов, содержащих точку t
+    int stab_count(int t) const;
+    // число интервалов, пересекающих [a, b]
+    int overlap_count(int a, int b) const;
+
+    // все интервалы, пересекающие [a, b], в порядке (lo_, hi_); O(k log n) для k найденных
+    std::vector<Interval> find_overlapping(int a, int b) const;
+    // все интервалы, содержащие точку t
+    std::vector<Interval> find_stabbing(int t) const;
+};
+
+}
@@ -1,5 +1,7 @@
 #include "os_tree.hpp"
 #include "dothtml.hpp"
+#include "server.hpp"
+#include "trace.hpp"
 
 #include <iostream>
 #include <string>
@@ -7,8 +9,61 @@
 #include <vector>
 #include <fstream>
 #include <cstdlib>
+#include <csignal>
+#include <memory>
 
-int main() {
+namespace {
+
+OS_Tree::TreeServer* running_server = nullptr;
+
+void handle_stop_signal(int) {
+    if (running_server) {
+        running_server->stop();
+    }
+}
+
+// режим демона: дерево живет, пока процесс не получит SIGINT/SIGTERM
+int run_server(const std::string& socket_path, OS_Tree::TraceWriter* trace) {
+    OS_Tree::SearchTree tree;
+    OS_Tree::TreeServer server(tree, socket_path, trace);
+
+    running_server = &server;
+    std::signal(SIGINT,  handle_stop_signal);
+    std::signal(SIGTERM, handle_stop_signal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::cerr << "tree_app: serving on " << socket_path << std::endl;
+    server.run();
+    running_server = nullptr;
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+
+    std::string socket_path, trace_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--server" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (arg == "--record" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--server <socket_path>] [--record <trace>]" << std::endl;
+            return 1;
+        }
+    }
+
+    // запись команд для воспроизведения через trace_replay
+    std::unique_ptr<OS_Tree::TraceWriter> trace;
+    if (!trace_path.empty()) {
+        trace = std::make_unique<OS_Tree::TraceWriter>(trace_path);
+    }
+
+    if (!socket_path.empty()) {
+        return run_server(socket_path, trace.get());
+    }
 
     OS_Tree::SearchTree tree;
     std::string line;
@@ -22,9 +77,11 @@ int main() {
     while (iss >> cmd) {
         if (cmd == "k") {
             iss >> key;
+            if (trace) trace->record_insert(key);
             tree.insert(key);
         } else if (cmd == "q") {
             iss >> a >> b;
+            if (trace) trace->record_query(a, b);
             int count = tree.count_in_range(a, b);
             std::cout << count << std::endl;
         }
@@ -3,6 +3,7 @@
 #include <vector>
 #include <algorithm>
 #include <queue>
+#include <atomic>
 
 namespace OS_Tree {
 
@@ -14,8 +15,23 @@ namespace OS_Tree {
 #endif
 
 SearchTree::SearchTree() {
-    sentinel_index_ = nodes_.size();
+    init_avl();
+}
+
+SearchTree::SearchTree(std::pmr::memory_resource* pool) : nodes_(pool) {
+    init_avl();
+}
+
+uint32_t SearchTree::Generation::next() noexcept {
+    static std::atomic<uint32_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void SearchTree::init_avl() {
+    generation_.bump();
+    nodes_.clear();
     nodes_.emplace_back(-999, sentinel_index_, -1);
+    size_ = 0;
 }
 
 int SearchTree::real_root() const {
@@ -201,24 +217,26 @@ int SearchTree::balance_node(int node_index, int key) {
     upd_node_ctx(node_index);
     int balance = get_balance(node_index);
     DBG_PRINT("balance: %d\n", balance);
+    // ветки взаимоисключающие: после поворота node_index уже указывает на новый корень, и повторная
+    // проверка условий по нему с прежним balance развернула бы поддерево второй раз
     // Левый левый
     if (balance > 1 && key < get_node_key(nodes_[node_index].left_index_)) {
         DBG_PRINT("LL\n");
         node_index = right_rotate(node_index);
     }
     // Правый правый
-    if (balance < -1 && key > get_node_key(nodes_[node_index].right_index_)) {
+    else if (balance < -1 && key > get_node_key(nodes_[node_index].right_index_)) {
         DBG_PRINT("RR\n");
         node_index = left_rotate(node_index);
     }
     // Левый правый
-    if (balance > 1 && key > get_node_key(nodes_[node_index].left_index_)) {
+    else if (balance > 1 && key > get_node_key(nodes_[node_index].left_index_)) {
         DBG_PRINT("LR\n");
         left_rotate(nodes_[node_index].left_index_);
         node_index = right_rotate(node_index);
     }
     // Правый левый
-    if (balance < -1 && key < get_node_key(nodes_[node_index].right_index_)) {
+    else if (balance < -1 && key < get_node_key(nodes_[node_index].right_index_)) {
         DBG_PRINT("RL\n");
         right_rotate(nodes_[node_index].right_index_);
         node_index = left_rotate(node_index);
@@ -287,6 +305,66 @@ int SearchTree::left_rotate(int A) {
     return B;
 }
 
+// построение из отсортированных ключей =========================================================================================//
+
+void SearchTree::assign_sorted(const std::vector<int>& keys) {
+    for (size_t i = 1; i < keys.size(); ++i) {
+        if (keys[i - 1] >= keys[i]) {
+            throw std::invalid_argument("assign_sorted: keys must be strictly increasing");
+        }
+    }
+
+    nodes_.reserve(keys.size() + 1);
+    init_avl();
+    nodes_[sentinel_index_].left_index_ = build_balanced(keys, 0, keys.size(), sentinel_index_);
+    size_ = keys.size();
+}
+
+int SearchTree::build_balanced(const std::vector<int>& keys, int lo, int hi, int parent_index) {
+    if (lo >= hi) return -1;
+
+    int mid = lo + (hi - lo) / 2;
+    int node_index = nodes_.size();
+    nodes_.emplace_back(keys[mid], node_index, parent_index);       // узлы ложатся в массив в preorder
+
+    int left_index  = build_balanced(keys, lo, mid, node_index);
+    int right_index = build_balanced(keys, mid + 1, hi, node_index);
+    nodes_[node_index].left_index_  = left_index;
+    nodes_[node_index].right_index_ = right_index;
+    upd_node_ctx(node_index);
+
+    return node_index;
+}
+
+bool SearchTree::contains(int key) const {
+    NodeNavigator node_navi = get_navigator_by_key(real_root(), key);
+    return node_navi.is_current_index_valid() && node_navi.get_key() == key;
+}
+
+int SearchTree::size() const {
+    return size_;
+}
+
+std::vector<int> SearchTree::keys() const {
+    std::vector<int> result;
+    result.reserve(size_);
+
+    std::stack<int> path;
+    int node_index = real_root();
+    while (is_node_active(node_index) || !path.empty()) {
+        while (is_node_active(node_index)) {
+            path.push(node_index);
+            node_index = nodes_[node_index].left_index_;
+        }
+        node_index = path.top();
+        path.pop();
+        result.push_back(nodes_[node_index].key_);
+        node_index = nodes_[node_index].right_index_;
+    }
+
+    return result;
+}
+
 // методы для нахождения количества ключей на отрезке ===========================================================================//
 
 int SearchTree::node_rank(int node_index, int x) const {
@@ -321,6 +399,96 @@ int SearchTree::count_in_range(int a, int b) const {
     return rank(b) - rank(a - 1);
 }
 
+// перекладка узлов ==============================================================================================================//
+
+void SearchTree::swap_nodes(int p, int q) {
+    if (p == q) return;
+
+    std::swap(nodes_[p], nodes_[q]);
+    nodes_[p].index_ = p;
+    nodes_[q].index_ = q;
+
+    // ссылки на p и q могут быть у их родителей и детей, а также у самих p и q (если они соседи)
+    int affected[8] = {
+        p, nodes_[p].parent_index_, nodes_[p].left_index_, nodes_[p].right_index_,
+        q, nodes_[q].parent_index_, nodes_[q].left_index_, nodes_[q].right_index_
+    };
+    std::sort(affected, affected + 8);
+    int* affected_end = std::unique(affected, affected + 8);
+
+    for (int* it = affected; it != affected_end; ++it) {
+        if (*it < 0) continue;
+        Node& node = nodes_[*it];
+        for (int* link : {&node.parent_index_, &node.left_index_, &node.right_index_}) {
+            if (*link == p) {
+                *link = q;
+            } else if (*link == q) {
+                *link = p;
+            }
+        }
+    }
+}
+
+SearchTree::RelayoutCursor::RelayoutCursor(SearchTree& tree) : tree_(&tree) {
+    restart();
+}
+
+void SearchTree::RelayoutCursor::restart() {
+    generation_ = tree_->generation_.value();
+    pending_.clear();
+    if (tree_->nodes_.empty()) return;       // пустой nodes_ у перемещенного дерева
+
+    if (tree_->is_node_active(tree_->real_root())) {
+        pending_.push_back(tree_->real_root());
+    }
+    next_pos_ = tree_->sentinel_index_ + 1;
+}
+
+bool SearchTree::RelayoutCursor::step(int budget) {
+    if (generation_ != tree_->generation_.value()) {
+        // узлы созданы заново или дерево заменено другим, сохраненные индексы ничего не значат
+        restart();
+    }
+    std::pmr::vector<Node>& nodes = tree_->nodes_;
+
+    while (budget > 0 && !pending_.empty()) {
+        int node_index = pending_.back();
+        pending_.pop_back();
+        budget--;
+
+        // узел уже уложен: после поворота он оказался в чужом поддереве и был уложен вместе с ним
+        if (node_index < next_pos_) continue;
+
+        if (node_index != next_pos_) {
+            tree_->swap_nodes(node_index, next_pos_);
+            // в стеке могут ждать оба переставленных узла
+            for (int& index : pending_) {
+                if (index == next_pos_) {
+                    index = node_index;
+                } else if (index == node_index) {
+                    index = next_pos_;
+                }
+            }
+            node_index = next_pos_;
+        }
+        next_pos_++;
+
+        // уже уложенных потомков (после поворотов) не трогаем, вставленное под ними догонит следующий курсор;
+        // сначала правое, чтобы левое поддерево легло сразу за узлом
+        int right = nodes[node_index].right_index_;
+        int left  = nodes[node_index].left_index_;
+        if (tree_->is_node_active(right) && right >= next_pos_) pending_.push_back(right);
+        if (tree_->is_node_active(left)  && left  >= next_pos_) pending_.push_back(left);
+    }
+
+    return pending_.empty();
+}
+
+void SearchTree::relayout() {
+    RelayoutCursor cursor(*this);
+    while (!cursor.step(std::max(size_, 1))) {}
+}
+
 // для отладки
 void SearchTree::writeDot(const std::string& filename) const {
     std::ofstream file(filename);
@@ -5,9 +5,15 @@
 #include <fstream>
 #include <vector>
 #include <stack>
+#include <memory_resource>
+#include <cstdint>
 
 namespace OS_Tree {
 
+// Общий пул памяти для узлов множества деревьев, см. SearchTree(std::pmr::memory_resource*) и CompactSearchTree.
+// Однопоточный: деревья на одном пуле нельзя менять из разных потоков одновременно.
+using NodePool = std::pmr::unsynchronized_pool_resource;
+
 class SearchTree {
 private:
 
@@ -26,14 +32,42 @@ private:
         Node(int key, int self_index, int parent_index = -1) : key_(key), index_(self_index), parent_index_(parent_index) {}
     };
 
-    std::vector<Node>   nodes_;             // массив узлов
+    std::pmr::vector<Node> nodes_;          // массив узлов
     // std::stack<int>     free_indices_;
-    int sentinel_index_ = -1;               // неприкасаемый мнимый корень
+    static constexpr int sentinel_index_ = 0;   // неприкасаемый мнимый корень, всегда первый в nodes_
     int size_ = 0;                          // количество активных узлов
+    // Номер поколения nodes_: меняется, когда узлы создаются заново (init_avl, assign_sorted) или дерево
+    // копируется, перемещается или ему присваивают другое, и сбрасывает незавершенные RelayoutCursor.
+    // Номера берутся из общего счетчика, поэтому у разных деревьев они не совпадают и присваивание
+    // не может унести чужое поколение, равное поколению курсора. Вставки и повороты индексы узлов
+    // не меняют и поколение не трогают.
+    class Generation {
+    private:
+        uint32_t value_;
+        static uint32_t next() noexcept;
+
+    public:
+        Generation() noexcept : value_(next()) {}
+        Generation(const Generation&) noexcept : value_(next()) {}
+        Generation(Generation&& other) noexcept : value_(next()) { other.bump(); }
+        Generation& operator=(const Generation&) noexcept { bump(); return *this; }
+        Generation& operator=(Generation&& other) noexcept { bump(); other.bump(); return *this; }
+
+        void bump() noexcept { value_ = next(); }
+        uint32_t value() const noexcept { return value_; }
+    };
+    // 32 бита, чтобы вместе с size_ поле занимало одно 8-байтовое слово за nodes_
+    Generation generation_;
+
+    // создает пустое дерево: только sentinel node
+    void init_avl();
 
     // проверка валидности индекса узла
     bool is_node_active(int index) const;
 
+    // меняет местами узлы с индексами p и q и исправляет все ссылки на них (для RelayoutCursor)
+    void swap_nodes(int p, int q);
+
     // получить индекс прямого потомка sentinel node, реальный корень дерева
     int real_root() const;
     // accessors
@@ -64,6 +98,9 @@ private:
     void add_node(int parent_index, int key);
     // void remove(int key);
 
+    // строит идеально сбалансированное поддерево из keys[lo, hi), возвращает индекс его корня
+    int build_balanced(const std::vector<int>& keys, int lo, int hi, int parent_index);
+
     // Подсчитывает число узлов в поддереве со значением key <= x
     int node_rank(int node_index, int x) const;
     void print_tree_structure(std::ostream& os, int node_index) const;
@@ -107,6 +144,9 @@ public:
     // SearchTree не управляет ресурсами вручную, только сразу добавляет sentinel node в дерево
     // поэтому Rule of Zero не нарушено
     SearchTree();
+    // дерево, которое берет память под узлы из pool (например, общего NodePool на много деревьев).
+    // pool должен пережить дерево; копия дерева берет память уже из ресурса по умолчанию
+    explicit SearchTree(std::pmr::memory_resource* pool);
     SearchTree(SearchTree&& other) noexcept = default;
     SearchTree& operator=(SearchTree&& other) noexcept = default;
     SearchTree(const SearchTree& other) = default;
@@ -114,6 +154,15 @@ public:
     ~SearchTree() = default;
 
     void insert(int key);
+    // заменяет содержимое дерева ключами из keys (строго возрастающими) за O(n), без поворотов
+    void assign_sorted(const std::vector<int>& keys);
+
+    // есть ли key в дереве
+    bool contains(int key) const;
+    // количество ключей в дереве
+    int size() const;
+    // все ключи в порядке возрастания
+    std::vector<int> keys() const;
 
     NodeNavigator get_root_navigator() const;
     // просто создаст навигатор от соответствующего узла
@@ -127,6 +176,35 @@ public:
     // возвращает число узлов с key: key in (a, b]
     int count_in_range(int a, int b) const;
 
+    // Дефрагментация: после множества случайных вставок и поворотов соседние в дереве узлы оказываются
+    // разбросаны по nodes_ в порядке вставки. Курсор обходит дерево в preorder и переставляет узлы так,
+    // чтобы nodes_ шел в порядке обхода (каждое поддерево занимает непрерывный отрезок, спуск идет вперед
+    // по памяти); step делает не больше budget шагов и возвращает true, когда обход завершен.
+    // Состояние обхода живет в курсоре, а не в дереве, поэтому деревья, которые никто не перекладывает,
+    // за него не платят. Между вызовами step в дерево можно вставлять: уже уложенный префикс nodes_
+    // больше не трогается, обход продолжается с того же места, а узлы, вставленные или повернутые
+    // в уже пройденную часть, остаются где были (их уложит следующий курсор). Поэтому при вставках
+    // реже, чем budget узлов на вызов, обход всегда завершается.
+    // Курсор должен жить не дольше дерева. Индексы узлов, полученные ранее (NodeNavigator),
+    // после перекладки недействительны
+    class RelayoutCursor {
+    private:
+        SearchTree* tree_;
+        uint32_t generation_ = 0;           // поколение nodes_, для которого ведется обход
+        std::vector<int> pending_;          // корни еще не уложенных поддеревьев, стек preorder обхода
+        int next_pos_ = 0;                  // nodes_[.. next_pos_) уже уложены, сюда ляжет следующий узел
+
+        void restart();
+
+    public:
+        explicit RelayoutCursor(SearchTree& tree);
+
+        bool step(int budget);
+    };
+
+    // перекладка целиком
+    void relayout();
+
     // графическая отладка
     // Графический дамп через html, используется для тестирования структуры дерева
     void writeDot(const std::string& filename) const;
@@ -0,0 +1,172 @@
+#include "quantile_sketch.hpp"
+
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <limits>
+
+namespace OS_Tree {
+
+QuantileSketch::QuantileSketch(int k, uint64_t seed) : k_(k), random_state_(seed ? seed : 1) {
+    if (k_ < 2) {
+        throw std::invalid_argument("QuantileSketch: k must be at least 2");
+    }
+    add_level();
+}
+
+int QuantileSketch::k_for_error(double epsilon) {
+    if (epsilon <= 0 || epsilon >= 1) {
+        throw std::invalid_argument("QuantileSketch::k_for_error: epsilon must be in (0, 1)");
+    }
+    // epsilon ~ 2.3 / k^0.97 - аппроксимация ошибки KLL из DataSketches
+    return std::max(2, static_cast<int>(std::ceil(std::pow(2.296 / epsilon, 1.0 / 0.9723))));
+}
+
+// компакторы ===================================================================================================================//
+
+int QuantileSketch::capacity(int level) const {
+    int depth = compactors_.size() - level - 1;
+    return std::max(2, static_cast<int>(std::ceil(k_ * std::pow(2.0 / 3.0, depth))));
+}
+
+void QuantileSketch::add_level() {
+    compactors_.emplace_back();
+    max_retained_ = 0;
+    for (size_t level = 0; level < compactors_.size(); ++level) {
+        max_retained_ += capacity(level);
+    }
+}
+
+bool QuantileSketch::random_bit() {
+    random_state_ ^= random_state_ << 13;
+    random_state_ ^= random_state_ >> 7;
+    random_state_ ^= random_state_ << 17;
+    return random_state_ & 1;
+}
+
+void QuantileSketch::compress() {
+    while (retained_ >= max_retained_) {
+        for (size_t level = 0; level < compactors_.size(); ++level) {
+            if (compactors_[level].size() < static_cast<size_t>(capacity(level))) continue;
+
+            if (level + 1 == compactors_.size()) {
+                add_level();
+            }
+            std::vector<int>& current = compactors_[level];
+            std::vector<int>& next    = compactors_[level + 1];
+
+            std::sort(current.begin(), current.end());
+            // при нечетном размере самый большой элемент остается на уровне, чтобы веса не терялись
+            size_t paired = current.size() & ~static_cast<size_t>(1);
+            size_t offset = random_bit() ? 1 : 0;
+            for (size_t i = offset; i < paired; i += 2) {
+                next.push_back(current[i]);
+            }
+            retained_ -= paired / 2;
+            if (paired < current.size()) {
+                current[0] = current.back();
+                current.resize(1);
+            } else {
+                current.clear();
+            }
+            break;
+        }
+    }
+}
+
+// вставка и слияние ============================================================================================================//
+
+void QuantileSketch::insert(int key) {
+    compactors_[0].push_back(key);
+    retained_++;
+    n_++;
+    if (retained_ >= max_retained_) {
+        compress();
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    if (&other == this) {
+        QuantileSketch copy = other;
+        merge(copy);
+        return;
+    }
+
+    k_ = std::min(k_, other.k_);
+    while (compactors_.size() < other.compactors_.size()) {
+        add_level();
+    }
+    // k_ могло уменьшиться, пересчитываем емкости
+    max_retained_ = 0;
+    for (size_t level = 0; level < compactors_.size(); ++level) {
+        max_retained_ += capacity(level);
+    }
+
+    for (size_t level = 0; level < other.compactors_.size(); ++level) {
+        const std::vector<int>& items = other.compactors_[level];
+        compactors_[level].insert(compactors_[level].end(), items.begin(), items.end());
+        retained_ += items.size();
+    }
+    n_ += other.n_;
+    compress();
+}
+
+// запросы ======================================================================================================================//
+
+long long QuantileSketch::rank(int x) const {
+    long long result = 0;
+    for (size_t level = 0; level < compactors_.size(); ++level) {
+        long long matching = 0;
+        for (int item : compactors_[level]) {
+            matching += item <= x;
+        }
+        result += matching << level;
+    }
+    return result;
+}
+
+long long QuantileSketch::count_in_range(int a, int b) const {
+    if (a > b) { return 0; }
+    long long below = (a == std::numeric_limits<int>::min()) ? 0 : rank(a - 1);
+    return rank(b) - below;
+}
+
+int QuantileSketch::quantile(double q) const {
+    if (n_ == 0) {
+        throw std::out_of_range("quantile: sketch is empty");
+    }
+    q = std::min(1.0, std::max(0.0, q));
+
+    std::vector<std::pair<int, long long>> weighted;
+    weighted.reserve(retained_);
+    for (size_t level = 0; level < compactors_.size(); ++level) {
+        for (int item : compactors_[level]) {
+            weighted.emplace_back(item, 1LL << level);
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+
+    // сумма весов хранимых элементов равна n_, ищем первый, на котором накопленный вес достигает q * n
+    long long target = static_cast<long long>(std::ceil(q * n_));
+    long long accumulated = 0;
+    for (const auto& [item, weight] : weighted) {
+        accumulated += weight;
+        if (accumulated >= target) return item;
+    }
+    return weighted.back().first;
+}
+
+long long QuantileSketch::size() const {
+    return n_;
+}
+
+int QuantileSketch::k() const {
+    return k_;
+}
+
+size_t QuantileSketch::retained() const {
+    return retained_;
+}
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace OS_Tree {
+
+// Приближенный аналог SearchTree с ограниченной памятью (KLL sketch).
+// Элементы копятся в иерархии компакторов: уровень h хранит элементы с весом 2^h. Переполненный
+// уровень сортируется, и каждый второй элемент (со случайным сдвигом) переходит на уровень выше,
+// остальные выбрасываются. Емкость уровней убывает в 2/3 раза сверху вниз, поэтому всего хранится
+// O(k) элементов, сколько бы их ни вставили, а ошибка rank порядка n / k.
+// В отличие от SearchTree, повторяющиеся значения учитываются каждое (sketch считает поток, а не множество).
+class QuantileSketch {
+private:
+    int k_;                                         // емкость верхнего уровня, задает точность
+    long long n_ = 0;                               // сколько всего элементов вставлено
+    std::vector<std::vector<int>> compactors_;      // compactors_[h] - элементы с весом 2^h
+    size_t retained_ = 0;                           // сколько элементов хранится сейчас
+    size_t max_retained_ = 0;                       // суммарная емкость уровней
+    uint64_t random_state_;                         // xorshift для выбора четных/нечетных при сжатии
+
+    int capacity(int level) const;
+    void add_level();
+    // сжимает самый нижний переполненный уровень, пока суммарно элементов не меньше емкости
+    void compress();
+    bool random_bit();
+
+public:
+    // k = 200 дает ошибку rank порядка 1% от n, k = 2000 - порядка 0.1%
+    explicit QuantileSketch(int k = 200, uint64_t seed = 0x9E3779B97F4A7C15ull);
+
+    // минимальное k, при котором ошибка rank / n с вероятностью ~99% не больше epsilon
+    // (эмпирическая оценка для KLL, проверяется бенчмарком sketch)
+    static int k_for_error(double epsilon);
+
+    void insert(int key);
+    // добавляет в sketch все элементы other (например, другого шарда), k берется меньший из двух
+    void merge(const QuantileSketch& other);
+
+    // приближенное число вставленных элементов <= x
+    long long rank(int x) const;
+    // приближенное число вставленных элементов в [a, b]
+    long long count_in_range(int a, int b) const;
+    // приближенный q-квантиль, q in [0, 1]; для пустого sketch бросает std::out_of_range
+    int quantile(double q) const;
+
+    long long size() const;
+    int k() const;
+    // сколько элементов sketch хранит в памяти
+    size_t retained() const;
+};
+
+}
@@ -0,0 +1,81 @@
+#include "rect_counter.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace OS_Tree {
+
+RectangleCounter::RectangleCounter(std::vector<Point> points) {
+    assign(std::move(points));
+}
+
+void RectangleCounter::assign(std::vector<Point> points) {
+    std::sort(points.begin(), points.end(), [](const Point& lhs, const Point& rhs) {
+        return lhs.x_ < rhs.x_;
+    });
+
+    size_t n = points.size();
+    xs_.resize(n);
+    levels_.assign(1, std::vector<int>(n));
+    for (size_t i = 0; i < n; ++i) {
+        xs_[i]         = points[i].x_;
+        levels_[0][i]  = points[i].y_;
+    }
+
+    // уровень k получается попарным слиянием соседних блоков уровня k - 1
+    for (size_t block = 1; block < n; block *= 2) {
+        const std::vector<int>& prev = levels_.back();
+        std::vector<int> next(n);
+        for (size_t begin = 0; begin < n; begin += 2 * block) {
+            size_t mid = std::min(begin + block, n);
+            size_t end = std::min(begin + 2 * block, n);
+            std::merge(prev.begin() + begin, prev.begin() + mid,
+                       prev.begin() + mid,   prev.begin() + end,
+                       next.begin() + begin);
+        }
+        levels_.push_back(std::move(next));
+    }
+}
+
+int RectangleCounter::size() const {
+    return xs_.size();
+}
+
+int RectangleCounter::count_in_block(int level, int block, int y1, int y2) const {
+    const std::vector<int>& ys = levels_[level];
+    size_t begin = static_cast<size_t>(block) << level;
+    size_t end   = std::min(begin + (static_cast<size_t>(1) << level), ys.size());
+
+    auto lo = std::lower_bound(ys.begin() + begin, ys.begin() + end, y1);
+    auto hi = std::upper_bound(lo, ys.begin() + end, y2);
+    return hi - lo;
+}
+
+int RectangleCounter::count(int x1, int x2, int y1, int y2) const {
+    if (x1 > x2 || y1 > y2) { return 0; }
+
+    // [l, r) - позиции точек с x in [x1, x2]
+    int l = std::lower_bound(xs_.begin(), xs_.end(), x1) - xs_.begin();
+    int r = std::upper_bound(xs_.begin(), xs_.end(), x2) - xs_.begin();
+
+    // снизу вверх, как в нерекурсивном дереве отрезков: на уровне level границы измеряются в блоках
+    int result = 0;
+    for (int level = 0; l < r; ++level) {
+        if (l & 1) {
+            result += count_in_block(level, l++, y1, y2);
+        }
+        if (r & 1) {
+            result += count_in_block(level, --r, y1, y2);
+        }
+        l >>= 1;
+        r >>= 1;
+    }
+
+    return result;
+}
+
+int RectangleCounter::count_dominated(int x, int y) const {
+    return count(std::numeric_limits<int>::min(), x, std::numeric_limits<int>::min(), y);
+}
+
+}
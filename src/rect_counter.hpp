@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+namespace OS_Tree {
+
+struct Point {
+    int x_;
+    int y_;
+};
+
+// Подсчет точек в прямоугольниках [x1, x2] x [y1, y2] (merge sort tree).
+// Точки сортируются по x, над этим порядком строится дерево отрезков, в каждом узле которого
+// y его точек лежат отсортированными. Прямоугольник по x раскладывается на O(log n) узлов,
+// в каждом число подходящих y находится двумя бинарными поисками: запрос за O(log^2 n),
+// память и построение O(n log n).
+// Структура статическая: все точки загружаются сразу в конструкторе или через assign().
+// В отличие от SearchTree, повторяющиеся точки учитываются столько раз, сколько они встречаются.
+class RectangleCounter {
+private:
+    std::vector<int> xs_;                   // x точек по возрастанию
+    // levels_[k] - y точек в порядке xs_, отсортированные внутри блоков длины 2^k
+    std::vector<std::vector<int>> levels_;
+
+    // число y из [y1, y2] в блоке block уровня level
+    int count_in_block(int level, int block, int y1, int y2) const;
+
+public:
+    RectangleCounter() = default;
+    explicit RectangleCounter(std::vector<Point> points);
+
+    // заменяет все точки за O(n log n)
+    void assign(std::vector<Point> points);
+
+    int size() const;
+    // число точек с x in [x1, x2] и y in [y1, y2], границы включаются
+    int count(int x1, int x2, int y1, int y2) const;
+    // число точек, доминируемых (x, y): px <= x и py <= y
+    int count_dominated(int x, int y) const;
+};
+
+}
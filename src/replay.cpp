@@ -0,0 +1,99 @@
+// Воспроизведение трассы, записанной tree_app --record, на SearchTree:
+// пропускная способность, перцентили задержек по типам операций и состояние дерева в конце.
+
+#include "os_tree.hpp"
+#include "trace.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+void print_latencies(const char* name, const OS_Tree::LatencyHistogram& histogram) {
+    if (histogram.count() == 0) return;
+    std::cout << name << ": " << histogram.count() << " ops, latency ns"
+              << "  p50 "   << histogram.percentile(0.5)
+              << "  p99 "   << histogram.percentile(0.99)
+              << "  p99.9 " << histogram.percentile(0.999)
+              << "  max "   << histogram.max() << "\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    bool paced = false;
+    std::string trace_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--paced") {
+            paced = true;
+        } else if (trace_path.empty()) {
+            trace_path = arg;
+        } else {
+            trace_path.clear();
+            break;
+        }
+    }
+    if (trace_path.empty()) {
+        std::cerr << "usage: " << argv[0] << " <trace> [--paced]\n"
+                  << "  --paced  keep the recorded gaps between operations instead of replaying as fast as possible\n";
+        return 1;
+    }
+
+    // трасса читается заранее, чтобы разбор файла не попадал в замеры
+    std::vector<OS_Tree::TraceRecord> records;
+    try {
+        OS_Tree::TraceReader reader(trace_path);
+        OS_Tree::TraceRecord record;
+        while (reader.next(record)) {
+            records.push_back(record);
+        }
+        if (reader.dropped_bytes() > 0) {
+            std::cerr << "trace_replay: trace is cut off, dropped " << reader.dropped_bytes()
+                      << " bytes of an incomplete last record\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "trace_replay: " << e.what() << "\n";
+        return 1;
+    }
+
+    using clock = std::chrono::steady_clock;
+    OS_Tree::SearchTree tree;
+    OS_Tree::LatencyHistogram insert_latency, query_latency;
+    long long checksum = 0;
+
+    clock::time_point start = clock::now();
+    for (const OS_Tree::TraceRecord& record : records) {
+        if (paced) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds(record.timestamp_us_));
+        }
+
+        clock::time_point op_start = clock::now();
+        if (record.op_ == 'k') {
+            tree.insert(record.a_);
+        } else {
+            checksum += tree.count_in_range(record.a_, record.b_);
+        }
+        uint64_t latency = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - op_start).count();
+
+        (record.op_ == 'k' ? insert_latency : query_latency).add(latency);
+    }
+    clock::time_point end = clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double recorded_seconds = records.empty() ? 0 : records.back().timestamp_us_ / 1e6;
+
+    std::cout << "replayed " << records.size() << " ops " << (paced ? "at recorded pacing" : "as fast as possible")
+              << " in " << std::fixed << std::setprecision(3) << seconds << " s (recorded " << recorded_seconds << " s), "
+              << std::setprecision(0) << (seconds > 0 ? records.size() / seconds : 0) << " ops/s\n";
+    print_latencies("k", insert_latency);
+    print_latencies("q", query_latency);
+
+    int height = tree.size() > 0 ? tree.get_root_navigator().get_height() : 0;
+    std::cout << "tree: " << tree.size() << " keys, height " << height << ", query checksum " << checksum << "\n";
+    return 0;
+}
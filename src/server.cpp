@@ -0,0 +1,329 @@
+#include "server.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <charconv>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace OS_Tree {
+
+#ifdef DEBUG
+#define DBG_PRINT(...) printf("%s:%d    ", __func__, __LINE__);  \
+                       printf(__VA_ARGS__)
+#else
+#define DBG_PRINT(...)
+#endif
+
+// разбор протокола =============================================================================================================//
+
+namespace {
+
+enum class TokenState {
+    NONE,           // до конца буфера одни пробелы
+    INCOMPLETE,     // токен упирается в конец буфера, возможно продолжение придет в следующем чтении
+    OK
+};
+
+TokenState next_token(const std::string& in, size_t& pos, bool at_eof, size_t& begin, size_t& end) {
+    while (pos < in.size() && std::isspace(static_cast<unsigned char>(in[pos]))) {
+        pos++;
+    }
+    if (pos == in.size()) return TokenState::NONE;
+
+    begin = pos;
+    while (pos < in.size() && !std::isspace(static_cast<unsigned char>(in[pos]))) {
+        pos++;
+    }
+    end = pos;
+    if (pos == in.size() && !at_eof) return TokenState::INCOMPLETE;
+    return TokenState::OK;
+}
+
+bool parse_int(const std::string& in, size_t begin, size_t end, int& value) {
+    auto [ptr, ec] = std::from_chars(in.data() + begin, in.data() + end, value);
+    return ec == std::errc() && ptr == in.data() + end;
+}
+
+}
+
+size_t process_commands(SearchTree& tree, const std::string& in, std::string& out, bool at_eof, TraceWriter* trace) {
+    size_t processed = 0;
+    size_t pos = 0;
+
+    while (true) {
+        size_t cmd_begin = 0, cmd_end = 0;
+        TokenState state = next_token(in, pos, at_eof, cmd_begin, cmd_end);
+        if (state == TokenState::NONE) {
+            return in.size();                               // хвост из пробелов тоже считаем обработанным
+        }
+        if (state == TokenState::INCOMPLETE) {
+            return processed;
+        }
+
+        int argc = 0;
+        if (cmd_end - cmd_begin == 1 && in[cmd_begin] == 'k') {
+            argc = 1;
+        } else if (cmd_end - cmd_begin == 1 && in[cmd_begin] == 'q') {
+            argc = 2;
+        } else {
+            DBG_PRINT("skipping unknown command at %zu\n", cmd_begin);
+            processed = pos;                                // как и однократный режим, пропускаем непонятный токен
+            continue;
+        }
+
+        int args[2] = {0, 0};
+        bool args_valid = true;
+        for (int i = 0; i < argc; ++i) {
+            size_t arg_begin = 0, arg_end = 0;
+            state = next_token(in, pos, at_eof, arg_begin, arg_end);
+            if (state != TokenState::OK) {
+                // аргументы еще не пришли; на EOF их уже не будет, обрезанную команду выбрасываем
+                return at_eof ? in.size() : processed;
+            }
+            if (!parse_int(in, arg_begin, arg_end, args[i])) {
+                args_valid = false;
+            }
+        }
+        processed = pos;
+
+        if (!args_valid) {
+            DBG_PRINT("skipping command with invalid arguments at %zu\n", cmd_begin);
+            continue;
+        }
+
+        if (argc == 1) {
+            if (trace) trace->record_insert(args[0]);
+            tree.insert(args[0]);
+        } else {
+            if (trace) trace->record_query(args[0], args[1]);
+            out += std::to_string(tree.count_in_range(args[0], args[1]));
+            out += '\n';
+        }
+    }
+}
+
+// TreeServer ===================================================================================================================//
+
+namespace {
+
+const size_t READ_CHUNK_SIZE     = 64 * 1024;
+const int    MAX_READS_PER_EVENT = 16;
+
+}
+
+TreeServer::TreeServer(SearchTree& tree, const std::string& socket_path, TraceWriter* trace)
+    : tree_(tree), socket_path_(socket_path), trace_(trace) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(addr.sun_path)) {
+        throw std::invalid_argument("TreeServer: socket path is too long: " + socket_path_);
+    }
+    std::strncpy(addr.sun_path, socket_path_.c_str(), sizeof(addr.sun_path) - 1);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ == -1) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+
+    unlink(socket_path_.c_str());
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+        listen(listen_fd_, SOMAXCONN) == -1) {
+        int err = errno;
+        close(listen_fd_);
+        throw std::runtime_error("TreeServer: could not listen on " + socket_path_ + ": " + std::strerror(err));
+    }
+
+    epoll_fd_  = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ == -1 || wakeup_fd_ == -1) {
+        int err = errno;
+        close(listen_fd_);
+        if (epoll_fd_  != -1) close(epoll_fd_);
+        if (wakeup_fd_ != -1) close(wakeup_fd_);
+        throw std::runtime_error(std::string("TreeServer: ") + std::strerror(err));
+    }
+
+    epoll_event ev{};
+    ev.events  = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev);
+    ev.data.fd = wakeup_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev);
+}
+
+TreeServer::~TreeServer() {
+    for (auto& [fd, conn] : connections_) {
+        close(fd);
+    }
+    close(wakeup_fd_);
+    close(epoll_fd_);
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+}
+
+void TreeServer::stop() {
+    uint64_t one = 1;
+    // write в eventfd async-signal-safe, поэтому stop() можно звать из обработчика сигнала
+    ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+void TreeServer::run() {
+    const int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+
+    while (true) {
+        // в простое никто не пишет в трассу, поэтому срок сброса ее буфера отслеживаем сами
+        int timeout = -1;
+        if (trace_) {
+            timeout = trace_->ms_until_flush();
+            if (timeout == 0) {
+                trace_->flush();
+                timeout = -1;
+            }
+        }
+
+        int n = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("epoll_wait: ") + std::strerror(errno));
+        }
+
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+
+            if (fd == wakeup_fd_) {
+                DBG_PRINT("stop requested\n");
+                return;
+            }
+            if (fd == listen_fd_) {
+                accept_connections();
+                continue;
+            }
+
+            auto it = connections_.find(fd);
+            if (it == connections_.end()) continue;
+            Connection& conn = it->second;
+
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                handle_readable(conn);
+            } else if (events[i].events & EPOLLOUT) {
+                if (!flush_output(conn)) {
+                    close_connection(fd);
+                    continue;
+                }
+                update_interest(conn);
+            }
+        }
+    }
+}
+
+void TreeServer::accept_connections() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            throw std::runtime_error(std::string("accept: ") + std::strerror(errno));
+        }
+
+        epoll_event ev{};
+        ev.events  = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            close(fd);
+            continue;
+        }
+        connections_.emplace(fd, Connection(fd));
+        DBG_PRINT("accepted connection %d\n", fd);
+    }
+}
+
+void TreeServer::handle_readable(Connection& conn) {
+    char buffer[READ_CHUNK_SIZE];
+    bool read_error = false;
+
+    // вычитываем все, что есть в сокете: чем больше команд в одной пачке, тем меньше системных вызовов на ответы.
+    // Число чтений ограничено, чтобы один активный клиент не копил вход бесконечно и не морил остальных
+    // пока клиент не забрал старые ответы, новые команды не читаем: иначе out_ растет без ограничения
+    for (int reads = 0; reads < MAX_READS_PER_EVENT && !conn.peer_closed_ && conn.out_.size() < MAX_PENDING_OUTPUT; ++reads) {
+        ssize_t got = read(conn.fd_, buffer, sizeof(buffer));
+        if (got > 0) {
+            conn.in_.append(buffer, got);
+        } else if (got == 0) {
+            conn.peer_closed_ = true;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            read_error = (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
+        }
+    }
+    if (read_error) {
+        close_connection(conn.fd_);
+        return;
+    }
+
+    size_t processed = process_commands(tree_, conn.in_, conn.out_, conn.peer_closed_, trace_);
+    conn.in_.erase(0, processed);
+
+    if (!flush_output(conn)) {
+        close_connection(conn.fd_);
+        return;
+    }
+    update_interest(conn);
+}
+
+bool TreeServer::flush_output(Connection& conn) {
+    size_t offset = 0;
+    while (offset < conn.out_.size()) {
+        ssize_t sent = send(conn.fd_, conn.out_.data() + offset, conn.out_.size() - offset, MSG_NOSIGNAL);
+        if (sent >= 0) {
+            offset += sent;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;                                          // допишем, когда сокет снова станет доступен на запись
+        } else {
+            return false;
+        }
+    }
+    // отправленное удаляем сразу, чтобы размер out_ был ровно объемом неотправленных ответов
+    conn.out_.erase(0, offset);
+    return true;
+}
+
+void TreeServer::update_interest(Connection& conn) {
+    epoll_event ev{};
+    ev.data.fd = conn.fd_;
+    ev.events  = 0;
+    if (!conn.peer_closed_ && conn.out_.size() < MAX_PENDING_OUTPUT) {
+        ev.events |= EPOLLIN;
+    }
+    if (!conn.out_.empty()) {
+        ev.events |= EPOLLOUT;
+    } else if (conn.peer_closed_) {
+        close_connection(conn.fd_);
+        return;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd_, &ev);
+}
+
+void TreeServer::close_connection(int fd) {
+    DBG_PRINT("closing connection %d\n", fd);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(fd);
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "os_tree.hpp"
+#include "trace.hpp"
+
+#include <string>
+#include <unordered_map>
+
+namespace OS_Tree {
+
+// Разбирает из in все завершенные команды протокола k/q, начиная с позиции 0, применяет их к tree
+// и дописывает ответы на q в out (по одному числу на строку).
+// Команда считается завершенной, если за ее последним токеном следует пробельный символ;
+// при at_eof == true незавершенным хвостом считается только обрезанная команда без аргументов.
+// Возвращает число полностью обработанных байт, необработанный хвост нужно оставить до следующего чтения.
+// Если задан trace, каждая примененная команда записывается в него.
+size_t process_commands(SearchTree& tree, const std::string& in, std::string& out, bool at_eof = false,
+                        TraceWriter* trace = nullptr);
+
+// Демон, который держит SearchTree в памяти и обслуживает протокол k/q через unix domain socket.
+// Однопоточный event loop на epoll: все сокеты неблокирующие, команды от клиента можно слать
+// конвейером, не дожидаясь ответов, ответы на все разобранные за одно чтение команды
+// отправляются одним пакетом.
+// Если клиент не читает ответы, сервер перестает читать его команды, пока неотправленных ответов
+// больше MAX_PENDING_OUTPUT: память на соединение ограничена, а клиент упирается в буфер сокета.
+class TreeServer {
+public:
+    static constexpr size_t MAX_PENDING_OUTPUT = 1 << 20;
+
+private:
+
+    struct Connection {
+        int fd_;
+        std::string in_;                // принятые, но еще не разобранные байты
+        std::string out_;               // ответы, ожидающие отправки (отправленное сразу удаляется)
+        bool peer_closed_   = false;    // клиент закрыл свою сторону, дописываем ответы и закрываем
+
+        explicit Connection(int fd) : fd_(fd) {}
+    };
+
+    SearchTree& tree_;
+    std::string socket_path_;
+    TraceWriter* trace_;
+
+    int listen_fd_ = -1;
+    int epoll_fd_  = -1;
+    int wakeup_fd_ = -1;                // eventfd, через который stop() будит event loop
+
+    std::unordered_map<int, Connection> connections_;
+
+    void accept_connections();
+    // читает доступные данные (если ответов накопилось не слишком много), разбирает команды и пытается сразу отправить ответы
+    void handle_readable(Connection& conn);
+    // возвращает false, если соединение нужно закрыть
+    bool flush_output(Connection& conn);
+    void update_interest(Connection& conn);
+    void close_connection(int fd);
+
+public:
+
+    // создает сокет по socket_path (старый файл сокета удаляется) и начинает слушать;
+    // если задан trace, в него пишутся команды всех клиентов в порядке применения
+    TreeServer(SearchTree& tree, const std::string& socket_path, TraceWriter* trace = nullptr);
+    TreeServer(const TreeServer&) = delete;
+    TreeServer& operator=(const TreeServer&) = delete;
+    ~TreeServer();
+
+    // блокирующий цикл обработки событий, возвращается после stop()
+    void run();
+    // можно вызывать из другого потока или обработчика сигнала
+    void stop();
+};
+
+}
@@ -0,0 +1,188 @@
+#include "trace.hpp"
+
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace OS_Tree {
+
+namespace {
+
+const char TRACE_MAGIC[8] = {'O', 'S', 'T', 'R', 'A', 'C', 'E', '1'};
+
+uint64_t zigzag_encode(int value) {
+    return (static_cast<uint64_t>(static_cast<int64_t>(value)) << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+int zigzag_decode(uint64_t value) {
+    return static_cast<int>(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+}
+
+}
+
+// TraceWriter ==================================================================================================================//
+
+TraceWriter::TraceWriter(const std::string& filename) : file_(filename, std::ios::binary | std::ios::trunc), start_(clock::now()) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("Could not open file for writing: " + filename);
+    }
+    file_.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    file_.flush();
+}
+
+void TraceWriter::write_varint(uint64_t value) {
+    char bytes[10];
+    int size = 0;
+    while (value >= 0x80) {
+        bytes[size++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    bytes[size++] = static_cast<char>(value);
+    file_.write(bytes, size);
+}
+
+void TraceWriter::write_record(char op, int argc, int a, int b) {
+    clock::time_point now = clock::now();
+    uint64_t timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(now - start_).count();
+
+    file_.put(op);
+    write_varint(timestamp_us - last_timestamp_us_);
+    write_varint(zigzag_encode(a));
+    if (argc == 2) {
+        write_varint(zigzag_encode(b));
+    }
+    last_timestamp_us_ = timestamp_us;
+
+    if (unflushed_records_ == 0) {
+        oldest_unflushed_ = now;
+    }
+    unflushed_records_++;
+    if (unflushed_records_ >= FLUSH_RECORDS || now - oldest_unflushed_ >= FLUSH_INTERVAL) {
+        flush();
+    }
+}
+
+void TraceWriter::record_insert(int key) {
+    write_record('k', 1, key, 0);
+}
+
+void TraceWriter::record_query(int a, int b) {
+    write_record('q', 2, a, b);
+}
+
+void TraceWriter::flush() {
+    file_.flush();
+    unflushed_records_ = 0;
+}
+
+int TraceWriter::ms_until_flush() const {
+    if (unflushed_records_ == 0) return -1;
+    auto left = oldest_unflushed_ + FLUSH_INTERVAL - clock::now();
+    if (left <= clock::duration::zero()) return 0;
+    // округляем вверх, чтобы не проснуться чуть раньше срока и не крутиться вхолостую
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(left).count());
+}
+
+// TraceReader ==================================================================================================================//
+
+TraceReader::TraceReader(const std::string& filename) : file_(filename, std::ios::binary) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("Could not open file for reading: " + filename);
+    }
+    char magic[sizeof(TRACE_MAGIC)];
+    if (!file_.read(magic, sizeof(magic)) || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0) {
+        throw std::runtime_error("Not a trace file: " + filename);
+    }
+}
+
+bool TraceReader::read_varint(uint64_t& value, size_t& record_bytes) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = file_.get();
+        if (byte == std::char_traits<char>::eof()) return false;
+        record_bytes++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    throw std::runtime_error("TraceReader: malformed varint in trace");
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    int op = file_.get();
+    if (op == std::char_traits<char>::eof()) return false;
+    if (op != 'k' && op != 'q') {
+        throw std::runtime_error("TraceReader: unknown operation in trace");
+    }
+
+    size_t record_bytes = 1;
+    uint64_t delta = 0, a = 0, b = 0;
+    bool complete = read_varint(delta, record_bytes) && read_varint(a, record_bytes);
+    if (complete && op == 'q') {
+        complete = read_varint(b, record_bytes);
+    }
+    if (!complete) {
+        // файл кончился посреди записи: как и недописанный хвост WAL, отбрасываем ее
+        dropped_bytes_ = record_bytes;
+        return false;
+    }
+
+    timestamp_us_ += delta;
+    record.op_ = static_cast<char>(op);
+    record.timestamp_us_ = timestamp_us_;
+    record.a_ = zigzag_decode(a);
+    record.b_ = zigzag_decode(b);
+    return true;
+}
+
+size_t TraceReader::dropped_bytes() const {
+    return dropped_bytes_;
+}
+
+// LatencyHistogram =============================================================================================================//
+
+int LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) return value;
+    // старшие SUB_BUCKET_BITS + 1 бит значения: экспонента и номер корзины внутри нее
+    int msb = 63 - __builtin_clzll(value);
+    int exponent = msb - SUB_BUCKET_BITS;
+    return exponent * SUB_BUCKETS + static_cast<int>(value >> exponent);
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(int index) {
+    if (index < 2 * SUB_BUCKETS) return index;
+    int exponent = index / SUB_BUCKETS - 1;
+    uint64_t sub_bucket = index - exponent * SUB_BUCKETS;
+    return ((sub_bucket + 1) << exponent) - 1;
+}
+
+void LatencyHistogram::add(uint64_t value) {
+    counts_[bucket_index(value)]++;
+    total_++;
+    if (value > max_) max_ = value;
+}
+
+uint64_t LatencyHistogram::count() const {
+    return total_;
+}
+
+uint64_t LatencyHistogram::max() const {
+    return max_;
+}
+
+uint64_t LatencyHistogram::percentile(double q) const {
+    if (total_ == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(std::ceil(q * total_));
+    if (target == 0) target = 1;
+
+    uint64_t accumulated = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        accumulated += counts_[i];
+        if (accumulated >= target) {
+            return std::min(bucket_upper_bound(i), max_);
+        }
+    }
+    return max_;
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <chrono>
+#include <array>
+#include <cstdint>
+
+namespace OS_Tree {
+
+// Бинарная трасса команд k/q для воспроизведения нагрузки (tree_app --record, trace_replay).
+// Формат: заголовок "OSTRACE1", затем записи подряд:
+//   байт операции ('k' или 'q'), varint - микросекунды с предыдущей записи,
+//   аргументы в zigzag varint (один для k, два для q).
+// Типичная запись занимает 4-8 байт.
+struct TraceRecord {
+    char op_ = 0;
+    uint64_t timestamp_us_ = 0;             // время от начала записи трассы
+    int a_ = 0;                             // ключ для k, левая граница для q
+    int b_ = 0;                             // правая граница для q
+};
+
+// Записи буферизуются и сбрасываются в файл каждые FLUSH_RECORDS записей или не позже FLUSH_INTERVAL
+// после самой старой несброшенной (срок проверяется при записи; в простое вызывающий сбрасывает
+// буфер сам по ms_until_flush). При падении процесса теряется только этот хвост.
+class TraceWriter {
+public:
+    static constexpr size_t FLUSH_RECORDS = 1024;
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{100};
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    std::ofstream file_;
+    clock::time_point start_;
+    uint64_t last_timestamp_us_ = 0;
+    size_t unflushed_records_ = 0;
+    clock::time_point oldest_unflushed_;
+
+    void write_varint(uint64_t value);
+    void write_record(char op, int argc, int a, int b);
+
+public:
+    explicit TraceWriter(const std::string& filename);
+
+    void record_insert(int key);
+    void record_query(int a, int b);
+    void flush();
+    // через сколько миллисекунд несброшенные записи нужно сбросить, 0 - уже пора, -1 - сбрасывать нечего
+    int ms_until_flush() const;
+};
+
+class TraceReader {
+private:
+    std::ifstream file_;
+    uint64_t timestamp_us_ = 0;
+    size_t dropped_bytes_ = 0;
+
+    // false, если файл кончился посреди varint
+    bool read_varint(uint64_t& value, size_t& record_bytes);
+
+public:
+    explicit TraceReader(const std::string& filename);
+
+    // false в конце трассы. Обрезанная последняя запись (писатель упал, не дописав буфер) тоже
+    // считается концом трассы, ее размер возвращает dropped_bytes(); на битой записи бросает std::runtime_error
+    bool next(TraceRecord& record);
+    // сколько байт недописанной последней записи было отброшено
+    size_t dropped_bytes() const;
+};
+
+// Гистограмма задержек с фиксированной памятью: 16 корзин на каждую степень двойки,
+// поэтому перцентиль определяется с относительной ошибкой не больше 1/16.
+class LatencyHistogram {
+private:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::array<uint64_t, BUCKETS> counts_{};
+    uint64_t total_ = 0;
+    uint64_t max_   = 0;
+
+    static int bucket_index(uint64_t value);
+    // наибольшее значение, попадающее в корзину
+    static uint64_t bucket_upper_bound(int index);
+
+public:
+    void add(uint64_t value);
+
+    uint64_t count() const;
+    uint64_t max() const;
+    // верхняя граница корзины, в которую попадает доля q in [0, 1] значений
+    uint64_t percentile(double q) const;
+};
+
+}
@@ -0,0 +1,376 @@
+#include "wal.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace OS_Tree {
+
+#ifdef DEBUG
+#define DBG_PRINT(...) printf("%s:%d    ", __func__, __LINE__);  \
+                       printf(__VA_ARGS__)
+#else
+#define DBG_PRINT(...)
+#endif
+
+namespace {
+
+const uint32_t CHECKPOINT_MAGIC = 0x5043534F;               // "OSCP"
+
+// сколько фоновый поток сброса спит без пачки; его будят раньше insert и деструктор, так что это лишь верхняя граница
+const std::chrono::seconds FLUSHER_IDLE_WAIT(1);
+
+struct LogRecord {
+    int32_t  key_;
+    uint32_t checksum_;
+};
+
+// контрольная сумма записи, чтобы отличить недописанный при падении хвост от настоящей записи
+uint32_t record_checksum(int32_t key) {
+    return (static_cast<uint32_t>(key) * 0x9E3779B1u) ^ 0xA5A5A5A5u;
+}
+
+uint32_t fnv1a(const void* data, size_t size, uint32_t hash = 2166136261u) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+[[noreturn]] void throw_errno(const std::string& what) {
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+void write_all(int fd, const char* data, size_t size, const std::string& what) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            throw_errno(what);
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+// после rename/создания файла нужно синхронизировать и саму директорию, иначе запись в ней может потеряться
+void sync_directory(const std::string& dir) {
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) throw_errno("open " + dir);
+    if (fsync(fd) == -1) {
+        close(fd);
+        throw_errno("fsync " + dir);
+    }
+    close(fd);
+}
+
+}
+
+DurableTree::DurableTree(const std::string& dir, const WalOptions& options) : dir_(dir), options_(options) {
+    if (options_.group_commit_size == 0) {
+        throw std::invalid_argument("DurableTree: group_commit_size must be positive");
+    }
+    if (mkdir(dir_.c_str(), 0755) == -1 && errno != EEXIST) {
+        throw_errno("mkdir " + dir_);
+    }
+
+    recover();
+
+    log_fd_ = open(log_path().c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (log_fd_ == -1) throw_errno("open " + log_path());
+    sync_directory(dir_);
+
+    pending_.reserve(options_.group_commit_size * sizeof(LogRecord));
+
+    if (options_.max_commit_delay.count() > 0) {
+        flusher_ = std::thread(&DurableTree::flusher_loop, this);
+    }
+}
+
+DurableTree::~DurableTree() {
+    if (flusher_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        flusher_wakeup_.notify_one();
+        flusher_.join();
+    }
+    try {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sync_locked();
+    } catch (const std::exception& e) {
+        DBG_PRINT("could not sync on destruction: %s\n", e.what());
+    }
+    if (log_fd_ != -1) close(log_fd_);
+}
+
+std::string DurableTree::log_path() const {
+    return dir_ + "/wal";
+}
+
+std::string DurableTree::checkpoint_path() const {
+    return dir_ + "/checkpoint";
+}
+
+// вставка и group commit =======================================================================================================//
+
+void DurableTree::insert(int key) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    rethrow_flusher_error();
+
+    int size_before = tree_.size();
+    tree_.insert(key);
+    if (tree_.size() == size_before) return;                // ключ уже был, в логе он есть
+
+    bool starts_batch = (pending_records_ == 0);
+    if (starts_batch) {
+        oldest_pending_ = clock::now();
+    }
+    LogRecord record{key, record_checksum(key)};
+    const char* bytes = reinterpret_cast<const char*>(&record);
+    pending_.insert(pending_.end(), bytes, bytes + sizeof(record));
+    pending_records_++;
+
+    if (pending_records_ >= options_.group_commit_size) {
+        sync_locked();
+    } else if (starts_batch && flusher_.joinable()) {
+        // фоновый поток спит без срока, пока пачка пуста; сообщаем ему срок новой пачки
+        lock.unlock();
+        flusher_wakeup_.notify_one();
+    }
+}
+
+void DurableTree::sync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rethrow_flusher_error();
+    sync_locked();
+}
+
+void DurableTree::rethrow_flusher_error() {
+    if (flusher_error_) {
+        std::exception_ptr error = flusher_error_;
+        flusher_error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void DurableTree::flusher_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (pending_records_ == 0) {
+            flusher_wakeup_.wait_for(lock, FLUSHER_IDLE_WAIT);
+            continue;
+        }
+        clock::time_point deadline = oldest_pending_ + options_.max_commit_delay;
+        if (clock::now() < deadline) {
+            flusher_wakeup_.wait_until(lock, deadline);
+            continue;                                       // пачку могли уже сбросить или начать новую
+        }
+        try {
+            sync_locked();
+        } catch (...) {
+            // пачка осталась в pending_: пользователь узнает об ошибке из следующего insert/sync, а мы повторим позже
+            flusher_error_ = std::current_exception();
+            flusher_wakeup_.wait_for(lock, FLUSHER_IDLE_WAIT);
+        }
+    }
+}
+
+void DurableTree::sync_locked() {
+    if (pending_records_ == 0) return;
+
+    if (log_dirty_) {
+        // прошлая попытка могла дописать пачку частично (например, ENOSPC после короткого write);
+        // повтор поверх обрывка сдвинул бы записи, и восстановление отбросило бы все после него
+        off_t committed_size = log_records_ * sizeof(LogRecord);
+        if (ftruncate(log_fd_, committed_size) == -1) throw_errno("ftruncate " + log_path());
+        log_dirty_ = false;
+    }
+
+    log_dirty_ = true;
+    write_all(log_fd_, pending_.data(), pending_.size(), "write " + log_path());
+    if (fdatasync(log_fd_) == -1) throw_errno("fdatasync " + log_path());
+    log_dirty_ = false;
+    DBG_PRINT("committed %zu records\n", pending_records_);
+
+    log_records_ += pending_records_;
+    pending_.clear();
+    pending_records_ = 0;
+
+    if (options_.checkpoint_interval > 0 && log_records_ >= options_.checkpoint_interval) {
+        checkpoint_locked();
+    }
+}
+
+// checkpoint ===================================================================================================================//
+
+void DurableTree::checkpoint() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rethrow_flusher_error();
+    checkpoint_locked();
+}
+
+void DurableTree::checkpoint_locked() {
+    std::vector<int> keys = tree_.keys();
+    uint32_t header[2] = {CHECKPOINT_MAGIC, static_cast<uint32_t>(keys.size())};
+    uint32_t checksum = fnv1a(keys.data(), keys.size() * sizeof(int));
+
+    std::string tmp_path = checkpoint_path() + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) throw_errno("open " + tmp_path);
+    try {
+        write_all(fd, reinterpret_cast<const char*>(header), sizeof(header), "write " + tmp_path);
+        write_all(fd, reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(int), "write " + tmp_path);
+        write_all(fd, reinterpret_cast<const char*>(&checksum), sizeof(checksum), "write " + tmp_path);
+        if (fsync(fd) == -1) throw_errno("fsync " + tmp_path);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+
+    if (rename(tmp_path.c_str(), checkpoint_path().c_str()) == -1) throw_errno("rename " + tmp_path);
+    sync_directory(dir_);
+
+    // снимок на диске и содержит все дерево, несброшенные записи в лог писать уже не нужно.
+    // Раньше очищать нельзя: если снимок не запишется, они должны уйти в лог следующим sync()
+    pending_.clear();
+    pending_records_ = 0;
+
+    // если упадем до обрезки, при восстановлении лог проиграется поверх снимка, вставки идемпотентны
+    if (ftruncate(log_fd_, 0) == -1) throw_errno("ftruncate " + log_path());
+    if (fdatasync(log_fd_) == -1)    throw_errno("fdatasync " + log_path());
+    log_records_ = 0;
+    log_dirty_ = false;
+    DBG_PRINT("checkpoint with %zu keys\n", keys.size());
+}
+
+// восстановление ===============================================================================================================//
+
+void DurableTree::recover() {
+    recovery_stats_ = RecoveryStats();
+    load_checkpoint();
+    replay_log();
+}
+
+void DurableTree::load_checkpoint() {
+    int fd = open(checkpoint_path().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        if (errno == ENOENT) return;                        // снимка еще не было, все в логе
+        throw_errno("open " + checkpoint_path());
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw_errno("fstat " + checkpoint_path());
+    }
+    std::vector<char> data(st.st_size);
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t got = read(fd, data.data() + offset, data.size() - offset);
+        if (got <= 0) {
+            if (got == -1 && errno == EINTR) continue;
+            close(fd);
+            throw std::runtime_error("DurableTree: could not read " + checkpoint_path());
+        }
+        offset += got;
+    }
+    close(fd);
+
+    uint32_t header[2] = {0, 0};
+    if (data.size() < sizeof(header) + sizeof(uint32_t)) {
+        throw std::runtime_error("DurableTree: checkpoint is truncated");
+    }
+    std::memcpy(header, data.data(), sizeof(header));
+    size_t keys_bytes = static_cast<size_t>(header[1]) * sizeof(int);
+    if (header[0] != CHECKPOINT_MAGIC || data.size() != sizeof(header) + keys_bytes + sizeof(uint32_t)) {
+        throw std::runtime_error("DurableTree: checkpoint is corrupted");
+    }
+
+    std::vector<int> keys(header[1]);
+    std::memcpy(keys.data(), data.data() + sizeof(header), keys_bytes);
+    uint32_t checksum = 0;
+    std::memcpy(&checksum, data.data() + sizeof(header) + keys_bytes, sizeof(checksum));
+    if (checksum != fnv1a(keys.data(), keys_bytes)) {
+        throw std::runtime_error("DurableTree: checkpoint checksum mismatch");
+    }
+
+    tree_.assign_sorted(keys);
+    recovery_stats_.checkpoint_keys = keys.size();
+}
+
+void DurableTree::replay_log() {
+    int fd = open(log_path().c_str(), O_RDWR | O_CLOEXEC);
+    if (fd == -1) {
+        if (errno == ENOENT) return;
+        throw_errno("open " + log_path());
+    }
+
+    const size_t RECORDS_PER_READ = 4096;
+    std::vector<LogRecord> records(RECORDS_PER_READ);
+    size_t valid_bytes = 0;
+    size_t total_bytes = 0;
+    bool torn = false;
+
+    while (!torn) {
+        ssize_t got = read(fd, records.data(), records.size() * sizeof(LogRecord));
+        if (got == -1) {
+            if (errno == EINTR) continue;
+            close(fd);
+            throw_errno("read " + log_path());
+        }
+        if (got == 0) break;
+        total_bytes += got;
+
+        size_t complete = got / sizeof(LogRecord);
+        for (size_t i = 0; i < complete; ++i) {
+            if (records[i].checksum_ != record_checksum(records[i].key_)) {
+                torn = true;
+                break;
+            }
+            tree_.insert(records[i].key_);
+            valid_bytes += sizeof(LogRecord);
+            recovery_stats_.replayed_records++;
+        }
+        if (got % sizeof(LogRecord) != 0) {
+            torn = true;
+        }
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0) {
+        total_bytes = st.st_size;
+    }
+    if (valid_bytes < total_bytes) {
+        // все после первой битой записи - недописанная при падении пачка, ее никто не подтверждал
+        if (ftruncate(fd, valid_bytes) == -1 || fdatasync(fd) == -1) {
+            close(fd);
+            throw_errno("truncate " + log_path());
+        }
+        recovery_stats_.dropped_bytes = total_bytes - valid_bytes;
+    }
+    close(fd);
+
+    log_records_ = recovery_stats_.replayed_records;
+}
+
+const SearchTree& DurableTree::tree() const {
+    return tree_;
+}
+
+const RecoveryStats& DurableTree::recovery_stats() const {
+    return recovery_stats_;
+}
+
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "os_tree.hpp"
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+
+namespace OS_Tree {
+
+struct WalOptions {
+    // сколько вставок копить в памяти, прежде чем одним write + fdatasync сбросить их в лог
+    size_t group_commit_size = 256;
+    // сколько максимум самая старая несброшенная вставка может пролежать только в памяти: по истечении
+    // срока пачку сбрасывает фоновый поток, даже если новых вставок нет; 0 - без фонового потока,
+    // неполная пачка сбрасывается только по sync() и в деструкторе
+    std::chrono::microseconds max_commit_delay{1000};
+    // после стольких записей в логе автоматически делается checkpoint и лог обрезается, 0 - только вручную
+    size_t checkpoint_interval = 1 << 20;
+};
+
+struct RecoveryStats {
+    size_t checkpoint_keys  = 0;        // сколько ключей загружено из checkpoint
+    size_t replayed_records = 0;        // сколько записей проиграно из хвоста лога
+    size_t dropped_bytes    = 0;        // недописанный при падении хвост лога, который был отброшен
+};
+
+// SearchTree, вставки в который переживают падение процесса.
+// В директории dir лежат два файла:
+//   checkpoint - снимок всех ключей дерева в порядке возрастания;
+//   wal        - append-only лог вставок, сделанных после снимка.
+// Вставка сначала применяется к дереву и копится в буфере, а на диск уходит group commit'ом:
+// пачкой из group_commit_size записей или не позже чем через max_commit_delay после самой старой
+// вставки в пачке. Поэтому при падении можно потерять только вставки последних max_commit_delay;
+// sync() сбрасывает пачку принудительно.
+// Сам DurableTree рассчитан на одного пользователя: insert/sync/checkpoint не нужно вызывать из
+// разных потоков, внутренняя блокировка защищает только от фонового потока сброса.
+// Формат файлов платформенно-зависимый (порядок байт машины), переносить их между архитектурами нельзя.
+class DurableTree {
+private:
+    using clock = std::chrono::steady_clock;
+
+    SearchTree tree_;
+    std::string dir_;
+    WalOptions options_;
+
+    int log_fd_ = -1;
+    std::vector<char> pending_;             // сериализованные, но еще не записанные в лог записи
+    size_t pending_records_ = 0;
+    clock::time_point oldest_pending_;      // когда в pending_ попала самая старая запись
+    size_t log_records_ = 0;                // сколько записей в логе после последнего checkpoint
+    bool log_dirty_ = false;                // после неудачной записи в конце лога может остаться обрывок пачки
+
+    RecoveryStats recovery_stats_;
+
+    // фоновый сброс пачки по max_commit_delay
+    std::mutex mutex_;
+    std::condition_variable flusher_wakeup_;
+    std::thread flusher_;
+    bool stopping_ = false;
+    std::exception_ptr flusher_error_;     // ошибка фонового сброса, пробрасывается из следующего insert/sync
+
+    void flusher_loop();
+    // вызываются под mutex_
+    void sync_locked();
+    void checkpoint_locked();
+    void rethrow_flusher_error();
+
+    std::string log_path()        const;
+    std::string checkpoint_path() const;
+
+    // загружает checkpoint и проигрывает хвост лога, битый хвост лога обрезается
+    void recover();
+    void load_checkpoint();
+    void replay_log();
+
+public:
+
+    explicit DurableTree(const std::string& dir, const WalOptions& options = WalOptions());
+    DurableTree(const DurableTree&) = delete;
+    DurableTree& operator=(const DurableTree&) = delete;
+    // сбрасывает несохраненные вставки
+    ~DurableTree();
+
+    void insert(int key);
+    // записывает в лог все накопленные вставки и дожидается fdatasync
+    void sync();
+    // пишет снимок дерева рядом с текущим, атомарно подменяет его через rename и обрезает лог
+    void checkpoint();
+
+    const SearchTree& tree() const;
+    const RecoveryStats& recovery_stats() const;
+};
+
+}
@@ -0,0 +1,51 @@
+#include "../src/buffered_tree.hpp"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+#include <random>
+#include <iterator>
+
+TEST(BufferedSearchTreeTest, queries_see_buffer) {
+    OS_Tree::BufferedSearchTree tree(100);
+    tree.insert(10);
+    tree.insert(20);
+    tree.insert(10);
+
+    EXPECT_EQ(tree.buffered(), 3u);
+    EXPECT_EQ(tree.count_in_range(8, 31), 2);
+    EXPECT_EQ(tree.size(), 2);
+
+    tree.flush();
+    EXPECT_EQ(tree.buffered(), 0u);
+    EXPECT_EQ(tree.tree().size(), 2);
+
+    // ключ, который уже есть в дереве, не должен посчитаться второй раз
+    tree.insert(20);
+    tree.insert(30);
+    EXPECT_EQ(tree.rank(25), 2);
+    EXPECT_EQ(tree.count_in_range(15, 40), 2);
+}
+
+TEST(BufferedSearchTreeTest, matches_set) {
+    OS_Tree::BufferedSearchTree tree(64);
+    std::set<int> reference;
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<> dis(0, 5000);
+
+    for (int i = 0; i < 20000; ++i) {
+        int key = dis(gen);
+        tree.insert(key);
+        reference.insert(key);
+
+        if (i % 97 == 0) {
+            int a = dis(gen), b = dis(gen);
+            if (a > b) std::swap(a, b);
+            ASSERT_EQ(tree.count_in_range(a, b), std::distance(reference.lower_bound(a), reference.upper_bound(b)));
+        }
+    }
+
+    tree.flush();
+    EXPECT_EQ(tree.tree().keys(), std::vector<int>(reference.begin(), reference.end()));
+}
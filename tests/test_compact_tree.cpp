@@ -0,0 +1,63 @@
+#include "../src/compact_tree.hpp"
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+TEST(CompactSearchTreeTest, promotion) {
+    OS_Tree::NodePool pool;
+    OS_Tree::CompactSearchTree tree(&pool);
+    std::set<int> reference;
+
+    for (int i = OS_Tree::CompactSearchTree::INLINE_CAPACITY; i > 0; --i) {
+        tree.insert(i * 3);
+        tree.insert(i * 3);                 // повторы в inline-режиме тоже игнорируются
+        reference.insert(i * 3);
+    }
+    EXPECT_TRUE(tree.is_inline_mode());
+    EXPECT_EQ(tree.size(), OS_Tree::CompactSearchTree::INLINE_CAPACITY);
+    EXPECT_EQ(tree.count_in_range(4, 30), 9);
+    EXPECT_EQ(tree.rank(0), 0);
+
+    tree.insert(1000);
+    reference.insert(1000);
+    EXPECT_FALSE(tree.is_inline_mode());
+    EXPECT_EQ(tree.keys(), std::vector<int>(reference.begin(), reference.end()));
+    EXPECT_EQ(tree.count_in_range(4, 30), 9);
+    EXPECT_EQ(tree.size(), OS_Tree::CompactSearchTree::INLINE_CAPACITY + 1);
+    EXPECT_TRUE(tree.contains(1000));
+
+    // небольшой набор ключей компактное дерево снова держит внутри объекта
+    tree.assign_sorted({1, 2, 3});
+    EXPECT_TRUE(tree.is_inline_mode());
+    EXPECT_EQ(tree.rank(2), 2);
+    EXPECT_THROW(tree.assign_sorted({1, 3, 3}), std::invalid_argument);
+}
+
+TEST(CompactSearchTreeTest, many_trees_share_pool) {
+    OS_Tree::NodePool pool;
+    std::vector<OS_Tree::CompactSearchTree> trees;
+    for (int t = 0; t < 100; ++t) {
+        trees.emplace_back(&pool);
+    }
+
+    for (int t = 0; t < 100; ++t) {
+        for (int key = 0; key < t; ++key) {
+            trees[t].insert(key);
+        }
+    }
+    for (int t = 0; t < 100; ++t) {
+        EXPECT_EQ(trees[t].size(), t);
+        EXPECT_EQ(trees[t].count_in_range(0, 9), std::min(t, 10));
+        EXPECT_EQ(trees[t].is_inline_mode(), t <= OS_Tree::CompactSearchTree::INLINE_CAPACITY);
+    }
+}
+
+TEST(CompactSearchTreeTest, footprint) {
+    // место под массив занимает только компактное дерево
+    EXPECT_LT(sizeof(OS_Tree::SearchTree), OS_Tree::CompactSearchTree::INLINE_CAPACITY * sizeof(int));
+    EXPECT_GE(sizeof(OS_Tree::CompactSearchTree), OS_Tree::CompactSearchTree::INLINE_CAPACITY * sizeof(int));
+}
@@ -0,0 +1,55 @@
+#include "../src/concurrent_tree.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(ConcurrentSearchTreeTest, single_thread) {
+    OS_Tree::ConcurrentSearchTree tree;
+    tree.insert(10);
+    tree.insert(20);
+    tree.insert(10);
+
+    EXPECT_EQ(tree.size(), 2);
+    EXPECT_EQ(tree.rank(15), 1);
+    EXPECT_EQ(tree.count_in_range(8, 31), 2);
+}
+
+TEST(ConcurrentSearchTreeTest, producers_and_consumers) {
+    const int PRODUCERS = 4;
+    const int KEYS_PER_PRODUCER = 5000;
+
+    OS_Tree::ConcurrentSearchTree tree;
+    std::atomic<bool> producing{true};
+    std::atomic<bool> monotonic{true};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&tree, p] {
+            for (int i = 0; i < KEYS_PER_PRODUCER; ++i) {
+                tree.insert(i * PRODUCERS + p);     // у каждого производителя свои ключи
+            }
+        });
+    }
+    // вставки только добавляют ключи, поэтому читатель не должен увидеть уменьшения
+    std::thread consumer([&] {
+        int last = 0;
+        while (producing.load()) {
+            int current = tree.count_in_range(0, PRODUCERS * KEYS_PER_PRODUCER);
+            if (current < last) monotonic = false;
+            last = current;
+        }
+    });
+
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+    producing = false;
+    consumer.join();
+
+    EXPECT_TRUE(monotonic.load());
+    EXPECT_EQ(tree.size(), PRODUCERS * KEYS_PER_PRODUCER);
+    EXPECT_EQ(tree.count_in_range(0, 99), 100);
+}
@@ -0,0 +1,71 @@
+#include "../src/interval_tree.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+namespace {
+
+std::vector<OS_Tree::Interval> overlapping_naive(const std::vector<OS_Tree::Interval>& intervals, int a, int b) {
+    std::vector<OS_Tree::Interval> result;
+    for (const OS_Tree::Interval& interval : intervals) {
+        if (interval.lo_ <= b && interval.hi_ >= a) result.push_back(interval);
+    }
+    std::sort(result.begin(), result.end(), [](const OS_Tree::Interval& lhs, const OS_Tree::Interval& rhs) {
+        return lhs.lo_ < rhs.lo_ || (lhs.lo_ == rhs.lo_ && lhs.hi_ < rhs.hi_);
+    });
+    return result;
+}
+
+}
+
+TEST(IntervalTreeTest, basic_test) {
+    OS_Tree::IntervalTree tree;
+    tree.insert({1, 5});
+    tree.insert({3, 8});
+    tree.insert({10, 12});
+    tree.insert({3, 8});                    // одинаковые интервалы хранятся оба
+
+    EXPECT_EQ(tree.size(), 4);
+    EXPECT_EQ(tree.stab_count(4), 3);
+    EXPECT_EQ(tree.stab_count(9), 0);
+    EXPECT_EQ(tree.stab_count(12), 1);
+    EXPECT_EQ(tree.overlap_count(6, 10), 3);
+    EXPECT_EQ(tree.find_stabbing(5), std::vector<OS_Tree::Interval>({{1, 5}, {3, 8}, {3, 8}}));
+
+    EXPECT_THROW(tree.insert({5, 1}), std::invalid_argument);
+}
+
+TEST(IntervalTreeTest, matches_naive) {
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> start(0, 10000);
+    std::uniform_int_distribution<> length(0, 300);
+
+    std::vector<OS_Tree::Interval> intervals(2000);
+    for (OS_Tree::Interval& interval : intervals) {
+        interval.lo_ = start(gen);
+        interval.hi_ = interval.lo_ + length(gen);
+    }
+
+    // одно дерево строится вставками (через повороты), второе - массовой загрузкой
+    OS_Tree::IntervalTree inserted;
+    for (const OS_Tree::Interval& interval : intervals) {
+        inserted.insert(interval);
+    }
+    OS_Tree::IntervalTree loaded;
+    loaded.assign(intervals);
+
+    for (int i = 0; i < 300; ++i) {
+        int a = start(gen);
+        int b = a + length(gen);
+        std::vector<OS_Tree::Interval> expected = overlapping_naive(intervals, a, b);
+
+        ASSERT_EQ(inserted.overlap_count(a, b), static_cast<int>(expected.size()));
+        ASSERT_EQ(loaded.overlap_count(a, b),   static_cast<int>(expected.size()));
+        ASSERT_EQ(inserted.find_overlapping(a, b), expected);
+        ASSERT_EQ(loaded.find_overlapping(a, b),   expected);
+        ASSERT_EQ(inserted.stab_count(a), static_cast<int>(overlapping_naive(intervals, a, a).size()));
+    }
+}
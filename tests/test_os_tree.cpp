@@ -6,6 +6,8 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <set>
+#include <random>
 
 // это чтобы посмотреть корректность построения дерева
 void check_structure_with_dump() {
@@ -91,6 +93,165 @@ TEST(OS_TreeTest, rank_test) {
     EXPECT_EQ(tree.rank(16), 3);    // 5, 10, 15 < 16
 }
 
+TEST(OS_TreeTest, random_inserts_stay_balanced) {
+    OS_Tree::SearchTree tree;
+    std::set<int> reference;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dis(0, 100000);
+
+    for (int i = 0; i < 20000; ++i) {
+        int key = dis(gen);
+        tree.insert(key);
+        reference.insert(key);
+    }
+
+    EXPECT_EQ(tree.keys(), std::vector<int>(reference.begin(), reference.end()));
+    // высота AVL не больше 1.44 * log2(n)
+    EXPECT_LE(tree.get_root_navigator().get_height(), 21);
+    EXPECT_EQ(tree.count_in_range(1000, 5000), std::distance(reference.lower_bound(1000), reference.upper_bound(5000)));
+}
+
+TEST(OS_TreeTest, assign_sorted_test) {
+    OS_Tree::SearchTree tree;
+    tree.insert(100);
+
+    std::vector<int> keys;
+    for (int i = 0; i < 1000; ++i) {
+        keys.push_back(i * 2);
+    }
+    tree.assign_sorted(keys);
+
+    EXPECT_EQ(tree.size(), 1000);
+    EXPECT_EQ(tree.keys(), keys);
+    EXPECT_EQ(tree.get_root_navigator().get_height(), 10);
+    EXPECT_EQ(tree.count_in_range(10, 19), 5);
+
+    // после построения дерево остается обычным AVL и принимает вставки
+    tree.insert(11);
+    EXPECT_EQ(tree.count_in_range(10, 19), 6);
+
+    EXPECT_THROW(tree.assign_sorted({1, 3, 3}), std::invalid_argument);
+}
+
+TEST(OS_TreeTest, pooled_tree) {
+    OS_Tree::NodePool pool;
+    OS_Tree::SearchTree tree(&pool);
+    for (int key = 100; key > 0; --key) {
+        tree.insert(key);
+    }
+    EXPECT_EQ(tree.size(), 100);
+    EXPECT_EQ(tree.count_in_range(10, 19), 10);
+
+    // копия берет память уже из ресурса по умолчанию и от пула не зависит
+    OS_Tree::SearchTree copy = tree;
+    EXPECT_EQ(copy.keys(), tree.keys());
+}
+
+// проверяет, что узлы лежат в nodes_ в порядке preorder, начиная сразу за sentinel
+bool is_preorder_layout(const OS_Tree::SearchTree& tree) {
+    std::vector<int> pending = {tree.get_root_navigator().current_index_};
+    int expected_index = 1;
+    while (!pending.empty()) {
+        OS_Tree::SearchTree::NodeNavigator navi = tree.get_navigator_by_index(pending.back());
+        pending.pop_back();
+        if (navi.current_index_ != expected_index++) return false;
+
+        OS_Tree::SearchTree::NodeNavigator right = navi, left = navi;
+        if (right.go_right()) pending.push_back(right.current_index_);
+        if (left.go_left())   pending.push_back(left.current_index_);
+    }
+    return true;
+}
+
+TEST(OS_TreeTest, incremental_relayout) {
+    OS_Tree::SearchTree tree;
+    std::set<int> reference;
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<> dis(0, 1000000);
+
+    for (int i = 0; i < 5000; ++i) {
+        int key = dis(gen);
+        tree.insert(key);
+        reference.insert(key);
+    }
+    EXPECT_FALSE(is_preorder_layout(tree));
+
+    OS_Tree::SearchTree::RelayoutCursor cursor(tree);
+    int steps = 0;
+    while (!cursor.step(256)) {
+        steps++;
+    }
+    EXPECT_GT(steps, 0);
+    EXPECT_TRUE(is_preorder_layout(tree));
+    EXPECT_EQ(tree.keys(), std::vector<int>(reference.begin(), reference.end()));
+    EXPECT_EQ(tree.count_in_range(1000, 500000), std::distance(reference.lower_bound(1000), reference.upper_bound(500000)));
+
+    // дерево после перекладки остается рабочим
+    tree.insert(-1);
+    EXPECT_EQ(tree.rank(-1), 1);
+}
+
+TEST(OS_TreeTest, relayout_finishes_under_inserts) {
+    const int N = 100000;
+    const int SLICE = 4096;
+
+    OS_Tree::SearchTree tree;
+    std::set<int> reference;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> dis(0, 1 << 30);
+    for (int i = 0; i < N; ++i) {
+        int key = dis(gen);
+        tree.insert(key);
+        reference.insert(key);
+    }
+
+    // по вставке на каждый кусок: обход не должен начинаться заново, поэтому хватает примерно N / SLICE кусков
+    OS_Tree::SearchTree::RelayoutCursor cursor(tree);
+    int slices = 1;
+    while (!cursor.step(SLICE)) {
+        int key = dis(gen);
+        tree.insert(key);
+        reference.insert(key);
+        slices++;
+        ASSERT_LE(slices, 2 * N / SLICE);
+    }
+    EXPECT_EQ(tree.keys(), std::vector<int>(reference.begin(), reference.end()));
+
+    // вставленное в уже уложенную часть доукладывает следующий курсор
+    tree.relayout();
+    EXPECT_TRUE(is_preorder_layout(tree));
+    EXPECT_EQ(tree.keys(), std::vector<int>(reference.begin(), reference.end()));
+}
+
+TEST(OS_TreeTest, relayout_cursor_survives_assignment) {
+    OS_Tree::SearchTree a, b;
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<> dis(0, 100000);
+    for (int i = 0; i < 1000; ++i) a.insert(dis(gen));
+    for (int key = 0; key < 20; ++key) b.insert(key);
+
+    // курсор по старому содержимому a не должен переставлять узлы нового
+    OS_Tree::SearchTree::RelayoutCursor cursor(a);
+    cursor.step(100);
+    a = b;
+    while (!cursor.step(64)) {}
+    EXPECT_EQ(a.keys(), b.keys());
+    EXPECT_EQ(a.rank(10), 11);
+    EXPECT_TRUE(is_preorder_layout(a));
+
+    // то же после перемещения: исходное дерево пусто, курсор по нему просто завершается
+    OS_Tree::SearchTree c;
+    for (int i = 0; i < 1000; ++i) c.insert(dis(gen));
+    OS_Tree::SearchTree::RelayoutCursor moved_cursor(c);
+    moved_cursor.step(100);
+    OS_Tree::SearchTree d = std::move(c);
+    while (!moved_cursor.step(64)) {}
+    OS_Tree::SearchTree::RelayoutCursor d_cursor(d);
+    while (!d_cursor.step(64)) {}
+    EXPECT_TRUE(is_preorder_layout(d));
+    EXPECT_EQ(d.size(), static_cast<int>(d.keys().size()));
+}
+
 int main(int argc, char* argv[]) {
     check_structure_with_dump();
     check_balancing_with_dump();
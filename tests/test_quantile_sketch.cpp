@@ -0,0 +1,67 @@
+#include "../src/quantile_sketch.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <cstdlib>
+
+namespace {
+
+std::vector<int> shuffled_keys(int n, unsigned seed) {
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(seed));
+    return keys;
+}
+
+}
+
+TEST(QuantileSketchTest, small_input_is_exact) {
+    // пока ничего не сжималось, sketch хранит все элементы и отвечает точно
+    OS_Tree::QuantileSketch sketch(200);
+    for (int key : {5, 1, 9, 1, 7}) {
+        sketch.insert(key);
+    }
+    EXPECT_EQ(sketch.size(), 5);
+    EXPECT_EQ(sketch.rank(1), 2);
+    EXPECT_EQ(sketch.count_in_range(2, 8), 2);
+    EXPECT_EQ(sketch.quantile(0.5), 5);
+    EXPECT_EQ(sketch.quantile(1.0), 9);
+
+    OS_Tree::QuantileSketch empty;
+    EXPECT_THROW(empty.quantile(0.5), std::out_of_range);
+}
+
+TEST(QuantileSketchTest, bounded_memory_and_error) {
+    const int N = 200000;
+    OS_Tree::QuantileSketch sketch(200);
+    for (int key : shuffled_keys(N, 1)) {
+        sketch.insert(key);
+    }
+
+    EXPECT_EQ(sketch.size(), N);
+    EXPECT_LT(sketch.retained(), 1000u);
+    for (int x = 0; x < N; x += N / 50) {
+        // точный rank на перестановке 0..N-1 равен x + 1
+        EXPECT_LE(std::llabs(sketch.rank(x) - (x + 1)), N / 50) << "x = " << x;
+    }
+    EXPECT_NEAR(sketch.quantile(0.5), N / 2, N / 50);
+}
+
+TEST(QuantileSketchTest, merge_shards) {
+    const int N = 100000;
+    std::vector<int> keys = shuffled_keys(N, 2);
+
+    OS_Tree::QuantileSketch left(200, 1), right(200, 2);
+    for (int i = 0; i < N; ++i) {
+        (i % 2 ? left : right).insert(keys[i]);
+    }
+    left.merge(right);
+
+    EXPECT_EQ(left.size(), N);
+    EXPECT_LT(left.retained(), 1000u);
+    EXPECT_LE(std::llabs(left.count_in_range(N / 4, 3 * N / 4 - 1) - N / 2), N / 25);
+}
@@ -0,0 +1,54 @@
+#include "../src/rect_counter.hpp"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+#include <random>
+
+namespace {
+
+int count_naive(const std::vector<OS_Tree::Point>& points, int x1, int x2, int y1, int y2) {
+    int result = 0;
+    for (const OS_Tree::Point& p : points) {
+        if (p.x_ >= x1 && p.x_ <= x2 && p.y_ >= y1 && p.y_ <= y2) result++;
+    }
+    return result;
+}
+
+}
+
+TEST(RectangleCounterTest, basic_test) {
+    OS_Tree::RectangleCounter counter({{1, 1}, {2, 5}, {3, 3}, {5, 2}, {5, 2}, {8, 7}});
+
+    EXPECT_EQ(counter.size(), 6);
+    EXPECT_EQ(counter.count(1, 5, 1, 3), 4);        // повторяющаяся точка (5, 2) считается дважды
+    EXPECT_EQ(counter.count(2, 8, 4, 10), 2);
+    EXPECT_EQ(counter.count(6, 7, 0, 100), 0);
+    EXPECT_EQ(counter.count(5, 1, 0, 100), 0);
+    EXPECT_EQ(counter.count_dominated(5, 3), 4);
+}
+
+TEST(RectangleCounterTest, empty) {
+    OS_Tree::RectangleCounter counter;
+    EXPECT_EQ(counter.count(0, 10, 0, 10), 0);
+    EXPECT_EQ(counter.count_dominated(10, 10), 0);
+}
+
+TEST(RectangleCounterTest, matches_naive) {
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> dis(-500, 500);
+
+    // некратное степени двойки число точек, чтобы задеть неполные блоки
+    std::vector<OS_Tree::Point> points(3001);
+    for (OS_Tree::Point& p : points) {
+        p = {dis(gen), dis(gen)};
+    }
+    OS_Tree::RectangleCounter counter(points);
+
+    for (int i = 0; i < 500; ++i) {
+        int x1 = dis(gen), x2 = dis(gen), y1 = dis(gen), y2 = dis(gen);
+        if (x1 > x2) std::swap(x1, x2);
+        if (y1 > y2) std::swap(y1, y2);
+        ASSERT_EQ(counter.count(x1, x2, y1, y2), count_naive(points, x1, x2, y1, y2));
+    }
+}
@@ -0,0 +1,162 @@
+#include "../src/os_tree.hpp"
+#include "../src/server.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+
+TEST(ServerTest, process_commands_basic) {
+    OS_Tree::SearchTree tree;
+    std::string in = "k 10 k 20 q 8 31 q 6 9 k 30 k 40 q 15 40\n";
+    std::string out;
+
+    EXPECT_EQ(OS_Tree::process_commands(tree, in, out), in.size());
+    EXPECT_EQ(out, "2\n0\n3\n");
+}
+
+TEST(ServerTest, process_commands_split_input) {
+    OS_Tree::SearchTree tree;
+    std::string out;
+
+    // команда, разрезанная между чтениями, не должна применяться раньше времени
+    std::string in = "k 10 k 2";
+    size_t processed = OS_Tree::process_commands(tree, in, out);
+    EXPECT_EQ(processed, 4u);
+    in.erase(0, processed);
+
+    in += "0 q 1";
+    processed = OS_Tree::process_commands(tree, in, out);
+    in.erase(0, processed);
+    EXPECT_EQ(out, "");
+
+    in += "5 25\n";
+    processed = OS_Tree::process_commands(tree, in, out);
+    EXPECT_EQ(processed, in.size());
+    EXPECT_EQ(out, "1\n");
+}
+
+TEST(ServerTest, process_commands_at_eof) {
+    OS_Tree::SearchTree tree;
+    std::string out;
+
+    // на EOF последний токен завершен и без перевода строки, а обрезанная команда отбрасывается
+    std::string in = "k 1 k 2 q 0 5";
+    EXPECT_EQ(OS_Tree::process_commands(tree, in, out, true), in.size());
+    EXPECT_EQ(out, "2\n");
+
+    out.clear();
+    in = "q 0 5 q 1";
+    EXPECT_EQ(OS_Tree::process_commands(tree, in, out, true), in.size());
+    EXPECT_EQ(out, "2\n");
+}
+
+TEST(ServerTest, pipelined_session) {
+    std::string socket_path = "/tmp/os_tree_test_" + std::to_string(getpid()) + ".sock";
+
+    OS_Tree::SearchTree tree;
+    OS_Tree::TreeServer server(tree, socket_path);
+    std::thread loop([&server] { server.run(); });
+
+    auto run_client = [&socket_path](const std::string& request) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        EXPECT_NE(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), -1);
+        EXPECT_EQ(write(fd, request.data(), request.size()), static_cast<ssize_t>(request.size()));
+        shutdown(fd, SHUT_WR);
+
+        std::string response;
+        char buffer[4096];
+        ssize_t got;
+        while ((got = read(fd, buffer, sizeof(buffer))) > 0) {
+            response.append(buffer, got);
+        }
+        close(fd);
+        return response;
+    };
+
+    std::string request;
+    for (int i = 0; i < 1000; ++i) {
+        request += "k " + std::to_string(i) + " ";
+    }
+    request += "q 0 999 q 10 19";
+
+    EXPECT_EQ(run_client(request), "1000\n10\n");
+    // дерево живет между соединениями
+    EXPECT_EQ(run_client("k 5000\nq 0 10000\n"), "1001\n");
+
+    server.stop();
+    loop.join();
+}
+
+TEST(ServerTest, client_that_does_not_read_is_throttled) {
+    std::string socket_path = "/tmp/os_tree_test_throttle_" + std::to_string(getpid()) + ".sock";
+
+    OS_Tree::SearchTree tree;
+    tree.insert(5);
+    OS_Tree::TreeServer server(tree, socket_path);
+    std::thread loop([&server] { server.run(); });
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    ASSERT_NE(connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)), -1);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    // шлем запросы, не читая ответы: сервер должен перестать читать, и запись упрется в буфер сокета
+    const std::string command = "q 0 10\n";
+    std::string chunk;
+    for (int i = 0; i < 1024; ++i) chunk += command;
+    const size_t LIMIT = 64 * OS_Tree::TreeServer::MAX_PENDING_OUTPUT;
+    size_t written = 0;
+    int idle_rounds = 0;
+    while (written < LIMIT && idle_rounds < 50) {
+        ssize_t sent = write(fd, chunk.data(), chunk.size());
+        if (sent > 0) {
+            // пишем только целые команды, чтобы потом сверить число ответов
+            written += sent;
+            if (sent % command.size() != 0) {
+                size_t rest = command.size() - sent % command.size();
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+                ASSERT_EQ(write(fd, command.data() + command.size() - rest, rest), static_cast<ssize_t>(rest));
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                written += rest;
+            }
+            idle_rounds = 0;
+        } else {
+            ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+            idle_rounds++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }
+    EXPECT_LT(written, LIMIT);
+
+    // после того как клиент начал читать, сервер отвечает на все команды
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    shutdown(fd, SHUT_WR);
+    size_t answers = 0;
+    char buffer[64 * 1024];
+    ssize_t got;
+    while ((got = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < got; ++i) {
+            answers += (buffer[i] == '\n');
+        }
+    }
+    close(fd);
+    EXPECT_EQ(answers, written / command.size());
+
+    server.stop();
+    loop.join();
+}
@@ -0,0 +1,115 @@
+#include "../src/trace.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+#include <limits>
+#include <fstream>
+#include <cstdio>
+
+#include <unistd.h>
+
+TEST(TraceTest, round_trip) {
+    std::string path = "/tmp/os_tree_trace_test_" + std::to_string(getpid()) + ".bin";
+    {
+        OS_Tree::TraceWriter writer(path);
+        writer.record_insert(10);
+        writer.record_insert(-7);
+        writer.record_query(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+        writer.record_insert(1 << 30);
+    }
+
+    OS_Tree::TraceReader reader(path);
+    std::vector<OS_Tree::TraceRecord> records;
+    OS_Tree::TraceRecord record;
+    while (reader.next(record)) {
+        records.push_back(record);
+    }
+    std::remove(path.c_str());
+
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(records[0].op_, 'k');
+    EXPECT_EQ(records[0].a_, 10);
+    EXPECT_EQ(records[1].a_, -7);
+    EXPECT_EQ(records[2].op_, 'q');
+    EXPECT_EQ(records[2].a_, std::numeric_limits<int>::min());
+    EXPECT_EQ(records[2].b_, std::numeric_limits<int>::max());
+    EXPECT_EQ(records[3].a_, 1 << 30);
+    for (size_t i = 1; i < records.size(); ++i) {
+        EXPECT_GE(records[i].timestamp_us_, records[i - 1].timestamp_us_);
+    }
+}
+
+TEST(TraceTest, truncated_record) {
+    std::string path = "/tmp/os_tree_trace_truncated_" + std::to_string(getpid()) + ".bin";
+    size_t first_record_end = 0;
+    {
+        OS_Tree::TraceWriter writer(path);
+        writer.record_insert(5);
+        writer.flush();
+        first_record_end = std::ifstream(path, std::ios::binary | std::ios::ate).tellg();
+        writer.record_query(1, 1000000);
+    }
+    size_t cut_size = 0;
+    {
+        // отрезаем последний байт записи
+        std::ifstream in(path, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        cut_size = data.size() - 1;
+        out.write(data.data(), cut_size);
+    }
+
+    // все целые записи читаются, обрезанная последняя считается концом трассы
+    OS_Tree::TraceReader reader(path);
+    OS_Tree::TraceRecord record;
+    ASSERT_TRUE(reader.next(record));
+    EXPECT_EQ(record.a_, 5);
+    EXPECT_FALSE(reader.next(record));
+    EXPECT_EQ(reader.dropped_bytes(), cut_size - first_record_end);
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, writer_flushes_periodically) {
+    std::string path = "/tmp/os_tree_trace_flush_" + std::to_string(getpid()) + ".bin";
+    OS_Tree::TraceWriter writer(path);
+    for (size_t i = 0; i < OS_Tree::TraceWriter::FLUSH_RECORDS; ++i) {
+        writer.record_insert(static_cast<int>(i));
+    }
+    EXPECT_EQ(writer.ms_until_flush(), -1);
+
+    // писатель еще жив и ничего не сбрасывал явно, но пачка из FLUSH_RECORDS записей уже в файле
+    OS_Tree::TraceReader reader(path);
+    OS_Tree::TraceRecord record;
+    size_t count = 0;
+    while (reader.next(record)) {
+        count++;
+    }
+    EXPECT_EQ(count, OS_Tree::TraceWriter::FLUSH_RECORDS);
+    EXPECT_EQ(reader.dropped_bytes(), 0u);
+
+    writer.record_insert(-1);
+    EXPECT_GE(writer.ms_until_flush(), 0);
+    EXPECT_LE(writer.ms_until_flush(), OS_Tree::TraceWriter::FLUSH_INTERVAL.count());
+    std::remove(path.c_str());
+}
+
+TEST(TraceTest, latency_histogram) {
+    OS_Tree::LatencyHistogram histogram;
+    EXPECT_EQ(histogram.percentile(0.5), 0u);
+
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.add(value);
+    }
+    histogram.add(1000000);
+
+    EXPECT_EQ(histogram.count(), 1001u);
+    EXPECT_EQ(histogram.max(), 1000000u);
+    // перцентиль с точностью до корзины: не меньше точного значения и не больше чем на 1/16 выше
+    EXPECT_GE(histogram.percentile(0.5), 501u);
+    EXPECT_LE(histogram.percentile(0.5), 501u + 501u / 16);
+    EXPECT_GE(histogram.percentile(0.99), 991u);
+    EXPECT_LE(histogram.percentile(0.99), 991u + 991u / 16);
+    EXPECT_EQ(histogram.percentile(1.0), 1000000u);
+}
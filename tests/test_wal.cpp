@@ -0,0 +1,160 @@
+#include "../src/os_tree.hpp"
+#include "../src/wal.hpp"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <cstdlib>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <csignal>
+
+class WalTest : public ::testing::Test {
+protected:
+    std::string dir_;
+
+    void SetUp() override {
+        char dir_template[] = "/tmp/os_tree_wal_test_XXXXXX";
+        ASSERT_NE(mkdtemp(dir_template), nullptr);
+        dir_ = dir_template;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+};
+
+TEST_F(WalTest, recover_from_log) {
+    OS_Tree::WalOptions options;
+    options.group_commit_size = 4;
+    {
+        OS_Tree::DurableTree durable(dir_, options);
+        for (int i = 0; i < 10; ++i) {
+            durable.insert(i * 10);
+        }
+        durable.insert(0);                  // повтор в лог не пишется
+    }
+
+    OS_Tree::DurableTree recovered(dir_, options);
+    EXPECT_EQ(recovered.tree().size(), 10);
+    EXPECT_EQ(recovered.tree().count_in_range(15, 45), 3);
+    EXPECT_EQ(recovered.recovery_stats().checkpoint_keys, 0u);
+    EXPECT_EQ(recovered.recovery_stats().replayed_records, 10u);
+}
+
+TEST_F(WalTest, checkpoint_truncates_log) {
+    OS_Tree::WalOptions options;
+    options.group_commit_size   = 1;
+    options.checkpoint_interval = 8;
+    {
+        OS_Tree::DurableTree durable(dir_, options);
+        for (int i = 0; i < 20; ++i) {
+            durable.insert(i);
+        }
+    }
+
+    OS_Tree::DurableTree recovered(dir_, options);
+    EXPECT_EQ(recovered.tree().size(), 20);
+    EXPECT_EQ(recovered.recovery_stats().checkpoint_keys, 16u);
+    EXPECT_EQ(recovered.recovery_stats().replayed_records, 4u);
+}
+
+TEST_F(WalTest, torn_tail_is_dropped) {
+    {
+        OS_Tree::DurableTree durable(dir_);
+        durable.insert(1);
+        durable.insert(2);
+    }
+    {
+        // имитируем падение посреди записи пачки
+        std::ofstream log(dir_ + "/wal", std::ios::binary | std::ios::app);
+        log.write("\x07\x00\x00", 3);
+    }
+
+    OS_Tree::DurableTree recovered(dir_);
+    EXPECT_EQ(recovered.tree().keys(), std::vector<int>({1, 2}));
+    EXPECT_EQ(recovered.recovery_stats().dropped_bytes, 3u);
+
+    recovered.insert(3);
+    recovered.sync();
+    OS_Tree::DurableTree again(dir_);
+    EXPECT_EQ(again.tree().keys(), std::vector<int>({1, 2, 3}));
+}
+
+TEST_F(WalTest, commit_delay_without_new_inserts) {
+    OS_Tree::WalOptions options;
+    options.group_commit_size = 1000;
+    options.max_commit_delay  = std::chrono::milliseconds(5);
+
+    OS_Tree::DurableTree durable(dir_, options);
+    durable.insert(1);
+    durable.insert(2);
+    durable.insert(3);
+
+    // пачка неполная и sync() никто не зовет, но через max_commit_delay она должна оказаться в логе
+    struct stat st{};
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        ASSERT_EQ(stat((dir_ + "/wal").c_str(), &st), 0);
+        if (st.st_size == 3 * 8) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_EQ(st.st_size, 3 * 8);
+}
+
+TEST_F(WalTest, failed_checkpoint_keeps_pending_inserts) {
+    OS_Tree::WalOptions options;
+    options.group_commit_size = 1000;
+    options.max_commit_delay  = std::chrono::microseconds(0);
+    {
+        OS_Tree::DurableTree durable(dir_, options);
+        durable.insert(1);
+        durable.insert(2);
+        durable.insert(3);
+
+        // временный файл снимка не создать: на его месте директория
+        ASSERT_EQ(mkdir((dir_ + "/checkpoint.tmp").c_str(), 0755), 0);
+        EXPECT_THROW(durable.checkpoint(), std::runtime_error);
+        durable.sync();
+    }
+
+    OS_Tree::DurableTree recovered(dir_, options);
+    EXPECT_EQ(recovered.tree().keys(), std::vector<int>({1, 2, 3}));
+}
+
+TEST_F(WalTest, short_write_is_rolled_back_before_retry) {
+    OS_Tree::WalOptions options;
+    options.group_commit_size = 1000;
+    options.max_commit_delay  = std::chrono::microseconds(0);
+    {
+        OS_Tree::DurableTree durable(dir_, options);
+        durable.insert(1);
+        durable.sync();
+        durable.insert(2);
+        durable.insert(3);
+
+        // лимит на размер файла посреди второй записи: write запишет ее половину и вернет EFBIG
+        rlimit old_limit{};
+        ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &old_limit), 0);
+        rlimit small_limit = old_limit;
+        small_limit.rlim_cur = 8 + 12;
+        auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+        ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &small_limit), 0);
+        EXPECT_THROW(durable.sync(), std::runtime_error);
+        ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &old_limit), 0);
+        std::signal(SIGXFSZ, old_handler);
+
+        durable.sync();
+        durable.insert(4);
+        durable.sync();
+    }
+
+    OS_Tree::DurableTree recovered(dir_, options);
+    EXPECT_EQ(recovered.tree().keys(), std::vector<int>({1, 2, 3, 4}));
+    EXPECT_EQ(recovered.recovery_stats().dropped_bytes, 0u);
+}